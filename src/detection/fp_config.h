@@ -141,17 +141,31 @@ public:
     int get_max_pattern_len()
     { return max_pattern_len; }
 
+    void set_compile_threads(unsigned n)
+    { compile_threads = n; }
+
+    unsigned get_compile_threads()
+    { return compile_threads; }
+
+    void set_search_batch(bool enable)
+    { search_batch = enable; }
+
+    bool get_search_batch()
+    { return search_batch; }
+
 private:
     const struct MpseApi* search_api;
 
     bool inspect_stream_insert;
     bool trim;
     bool split_any_any;
+    bool search_batch;
     bool debug_print_fast_pattern;
     bool debug;
 
     unsigned max_queue_events;
     unsigned bleedover_port_limit;
+    unsigned compile_threads;  // 0 means one per core
 
     int search_opt;
     int portlists_flags;
@@ -39,9 +39,18 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "fp_config.h"
 #include "service_map.h"
 #include "main/snort_config.h"
+#include "main/thread.h"
 #include "detection/rules.h"
 #include "detection/treenodes.h"
 #include "detection/fp_detect.h"
@@ -70,8 +79,6 @@
 
 static unsigned mpse_count = 0;
 
-static void fpDeletePMX(void* data);
-
 static int fpGetFinalPattern(FastPatternConfig*, PatternMatchData* pmd,
     char** ret_pattern, int* ret_bytes);
 
@@ -301,7 +308,6 @@ int otn_create_tree(OptTreeNode* otn, void** existing_tree)
 
 static int add_patrn_to_neg_list(void* id, void** list)
 {
-    PMX* pmx = (PMX*)id;
     NCListNode** ncl = (NCListNode**)list;
     NCListNode* node;
 
@@ -309,7 +315,7 @@ static int add_patrn_to_neg_list(void* id, void** list)
         return -1;
 
     node = (NCListNode*)SnortAlloc(sizeof(NCListNode));
-    node->pmx = pmx;
+    node->id = id;
     node->next = *ncl;
     *ncl = node;
 
@@ -334,28 +340,361 @@ static void neg_list_free(void** list)
     *list = NULL;
 }
 
-static int pmx_create_tree(SnortConfig* sc, void* id, void** existing_tree)
+//-------------------------------------------------------------------------
+// shared matchers
+// -- the fast patterns of a group are collected and sorted by rule and
+//    everything that goes into the engines makes up the key; groups with
+//    the same key share one set of engines, across configs too, so a
+//    reload only compiles groups whose fast patterns changed
+// -- the engines are given pattern ids instead of PMX pointers and the
+//    trees they keep are ids too, so nothing in them points into a config;
+//    each group binds the ids to its own PMX and trees
+// -- engines are compiled and trees are built once all groups are known,
+//    by a pool of threads; each job depends only on its own inputs and the
+//    trees are finalized in group order so the result is the same for any
+//    number of threads
+//-------------------------------------------------------------------------
+
+struct FpPattern
 {
-    PMX* pmx    = NULL;
-    RULE_NODE* rnNode = NULL;
-    OptTreeNode* otn    = NULL;
+    OptTreeNode* otn;
+    PatternMatchData* pmd;
+    const char* pat;
+    int len;
+};
 
-    if (!existing_tree)
+struct FpMatchers
+{
+    Mpse* mpse[PM_TYPE_MAX];
+    std::vector<std::vector<unsigned>> trees;  // pattern ids by tree id
+    std::string key;
+    unsigned size;  // patterns
+    unsigned refs;
+    bool failed;
+};
+
+struct FpBind
+{
+    PortGroup* pg;
+    std::vector<FpPattern> patterns;
+};
+
+typedef std::unordered_map<std::string, FpMatchers*> FpMatcherMap;
+
+static FpMatcherMap fp_matchers;            // by key; main thread only
+static std::vector<FpPattern> fp_patterns;  // of the group being built
+
+static std::vector<FpMatchers*> fp_compiles;  // waiting to be compiled
+static std::vector<FpBind> fp_binds;          // waiting for trees
+
+static THREAD_LOCAL FpMatchers* fp_building = nullptr;
+
+static unsigned groups_compiled = 0;
+static unsigned groups_shared = 0;
+
+// the engines own nothing behind the ids
+static void fp_free_id(void*) { }
+static void fp_free_tree(void**) { }
+
+// called for each non-negated pattern of a match state and then with a
+// null id; the tree is the index of the state's list of pattern ids
+static int fp_tree_ids(SnortConfig*, void* id, void** existing_tree)
+{
+    if ( !existing_tree )
         return -1;
 
-    if (!*existing_tree)
-        *existing_tree = new_root();
+    std::vector<std::vector<unsigned>>& trees = fp_building->trees;
+
+    if ( !*existing_tree )
+    {
+        trees.push_back(std::vector<unsigned>());
+        *existing_tree = (void*)(uintptr_t)trees.size();
+    }
+
+    if ( id )
+        trees[(uintptr_t)*existing_tree - 1].push_back((uintptr_t)id - 1);
+
+    return 0;
+}
+
+static bool fp_rule_order(const FpPattern& a, const FpPattern& b)
+{
+    if ( a.otn->sigInfo.generator != b.otn->sigInfo.generator )
+        return a.otn->sigInfo.generator < b.otn->sigInfo.generator;
+
+    return a.otn->sigInfo.id < b.otn->sigInfo.id;
+}
+
+static std::string fp_get_key(FastPatternConfig* fp)
+{
+    std::string key = fp->get_search_api()->base.name;
+    key += fp->get_search_opt() ? '+' : '-';
+
+    for ( auto& p : fp_patterns )
+    {
+        uint8_t flags = p.pmd->pm_type;
+
+        if ( p.pmd->no_case )
+            flags |= 0x10;
+
+        if ( p.pmd->negated )
+            flags |= 0x20;
+
+        key += (char)flags;
+        key.append((const char*)&p.len, sizeof(p.len));
+        key.append(p.pat, p.len);
+    }
+    return key;
+}
+
+// the engines are loaded here but compiled later
+static FpMatchers* fp_new_matchers(SnortConfig* sc, FastPatternConfig* fp)
+{
+    FpMatchers* fpm = new FpMatchers;
+    memset(fpm->mpse, 0, sizeof(fpm->mpse));
+    fpm->size = fp_patterns.size();
+    fpm->refs = 1;
+    fpm->failed = false;
+
+    for ( unsigned i = 0; i < fp_patterns.size(); ++i )
+    {
+        FpPattern& p = fp_patterns[i];
+        Mpse*& so = fpm->mpse[p.pmd->pm_type];
+
+        if ( !so )
+        {
+            so = MpseManager::get_search_engine(
+                sc, fp->get_search_api(), true, fp_free_id,
+                fp_free_tree, neg_list_free);
+
+            if ( !so )
+            {
+                ParseError("Failed to create pattern matcher for %d\n", p.pmd->pm_type);
+                continue;
+            }
+            mpse_count++;
+
+            if ( fp->get_search_opt() )
+                so->set_opt(1);
+        }
+
+        so->add_pattern(
+            sc, (const uint8_t*)p.pat, p.len, p.pmd->no_case, p.pmd->negated,
+            (void*)(uintptr_t)(i + 1), 0);
+    }
+
+    fp_compiles.push_back(fpm);
+    return fpm;
+}
+
+static FpMatchers* fp_get_matchers(SnortConfig* sc, FastPatternConfig* fp)
+{
+    std::stable_sort(fp_patterns.begin(), fp_patterns.end(), fp_rule_order);
+
+    // engines that finish compiling at setup are tied to their config
+    if ( fp->get_search_api()->setup )
+    {
+        groups_compiled++;
+        return fp_new_matchers(sc, fp);
+    }
+
+    std::string key = fp_get_key(fp);
+    FpMatcherMap::iterator it = fp_matchers.find(key);
+
+    if ( it != fp_matchers.end() )
+    {
+        groups_shared++;
+        it->second->refs++;
+        return it->second;
+    }
+
+    groups_compiled++;
+    FpMatchers* fpm = fp_new_matchers(sc, fp);
+    fpm->key.swap(key);
+    fp_matchers[fpm->key] = fpm;
+
+    return fpm;
+}
+
+static void fp_release_matchers(FpMatchers* fpm)
+{
+    if ( --fpm->refs )
+        return;
+
+    if ( !fpm->key.empty() )
+        fp_matchers.erase(fpm->key);
+
+    for ( int i = PM_TYPE_PKT; i < PM_TYPE_MAX; i++ )
+    {
+        if ( fpm->mpse[i] )
+            MpseManager::delete_search_engine(fpm->mpse[i]);
+    }
+    delete fpm;
+}
+
+// runs on a pool thread; the tree ids are assigned in pm type order
+static void fp_compile_matchers(SnortConfig* sc, FpMatchers* fpm)
+{
+    fp_building = fpm;
+
+    for ( int i = PM_TYPE_PKT; i < PM_TYPE_MAX; i++ )
+    {
+        Mpse* so = fpm->mpse[i];
+
+        if ( so && so->prep_patterns(sc, fp_tree_ids, add_patrn_to_neg_list) != 0 )
+            fpm->failed = true;
+    }
+
+    fp_building = nullptr;
+}
+
+// runs on a pool thread; the trees are built from this config's rules
+// and options but are finalized later since that updates the config
+static void fp_build_trees(FpBind& b)
+{
+    PortGroup* pg = b.pg;
+    FpMatchers* fpm = pg->matchers;
+    unsigned n = b.patterns.size();
+
+    pg->pmx = (PMX*)SnortAlloc(n * sizeof(PMX));
+    RULE_NODE* rn = (RULE_NODE*)SnortAlloc(n * sizeof(RULE_NODE));
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        rn[i].rnRuleData = b.patterns[i].otn;
+        pg->pmx[i].RuleNode = rn + i;
+        pg->pmx[i].PatternMatchData = b.patterns[i].pmd;
+    }
+
+    unsigned num_trees = fpm->trees.size();
+    pg->trees = (void**)SnortAlloc((num_trees + 1) * sizeof(void*));
+
+    for ( unsigned t = 0; t < num_trees; ++t )
+    {
+        pg->trees[t] = new_root();
+
+        for ( auto id : fpm->trees[t] )
+            otn_create_tree(b.patterns[id].otn, &pg->trees[t]);
+    }
+}
+
+// build phases for the startup summary
+enum FpPhase
+{
+    FP_PHASE_PORTS,
+    FP_PHASE_MAPS,
+    FP_PHASE_SERVICES,
+    FP_PHASE_COMPILE,
+    FP_PHASE_TREES,
+    FP_PHASE_MAX
+};
+
+static const char* fp_phase_names[FP_PHASE_MAX] =
+{
+    "port group secs",
+    "rule map secs",
+    "service group secs",
+    "mpse compile secs",
+    "option tree secs"
+};
+
+typedef std::chrono::steady_clock FpClock;
+
+// returns the time since start and restarts it
+static double fp_get_secs(FpClock::time_point& start)
+{
+    FpClock::time_point now = FpClock::now();
+    double secs = std::chrono::duration<double>(now - start).count();
+    start = now;
+    return secs;
+}
+
+// calls work(i) for each i in [0, n) on up to max threads, this one
+// included, and returns when all are done
+template<typename Work>
+static void fp_run_pool(unsigned n, unsigned max, Work work)
+{
+    std::atomic<unsigned> next { 0 };
+
+    auto worker = [&]()
+        {
+            unsigned i;
+
+            while ( (i = next++) < n )
+                work(i);
+        };
+
+    std::vector<std::thread> pool;
+
+    for ( unsigned t = 1; t < max && t < n; ++t )
+        pool.push_back(std::thread(worker));
+
+    worker();
+
+    for ( auto& t : pool )
+        t.join();
+}
 
-    if (!id)
+static unsigned fp_get_threads(FastPatternConfig* fp)
+{
+    // engines with a setup hook may not be safe to compile concurrently
+    if ( fp->get_search_api()->setup )
+        return 1;
+
+    unsigned n = fp->get_compile_threads();
+
+    if ( !n )
+        n = std::thread::hardware_concurrency();
+
+    return n ? n : 1;
+}
+
+static void fp_compile_groups(SnortConfig* sc, FastPatternConfig* fp, unsigned threads)
+{
+    // largest first so the pool finishes together; the order is otherwise
+    // immaterial since each engine is compiled on its own
+    std::vector<FpMatchers*> jobs(fp_compiles);
+
+    std::stable_sort(jobs.begin(), jobs.end(),
+        [](const FpMatchers* a, const FpMatchers* b)
+        { return a->size > b->size; });
+
+    fp_run_pool(jobs.size(), threads,
+        [&](unsigned i) { fp_compile_matchers(sc, jobs[i]); });
+
+    for ( auto* fpm : fp_compiles )
     {
-        /* NULL input id (PMX *), last call for this pattern state */
-        return finalize_detection_option_tree(sc, (detection_option_tree_root_t*)*existing_tree);
+        if ( fpm->failed )
+        {
+            FatalError("%s(%d) Failed to compile port group "
+                "patterns.\n", __FILE__, __LINE__);
+        }
+
+        if ( fp->get_debug_mode() )
+        {
+            for ( int i = PM_TYPE_PKT; i < PM_TYPE_MAX; i++ )
+            {
+                if ( fpm->mpse[i] )
+                    fpm->mpse[i]->print_info();
+            }
+        }
     }
+    fp_compiles.clear();
+}
+
+static void fp_build_groups(SnortConfig* sc, unsigned threads)
+{
+    fp_run_pool(fp_binds.size(), threads,
+        [&](unsigned i) { fp_build_trees(fp_binds[i]); });
 
-    pmx    = (PMX*)id;
-    rnNode = (RULE_NODE*)(pmx->RuleNode);
-    otn    = (OptTreeNode*)rnNode->rnRuleData;
-    return otn_create_tree(otn, existing_tree);
+    for ( auto& b : fp_binds )
+    {
+        PortGroup* pg = b.pg;
+
+        for ( unsigned t = 0; t < pg->matchers->trees.size(); ++t )
+            finalize_detection_option_tree(sc, (detection_option_tree_root_t*)pg->trees[t]);
+    }
+    fp_binds.clear();
 }
 
 /* FLP_Trim
@@ -616,38 +955,11 @@ static int fpFinishPortGroupRule(
         if (fpGetFinalPattern(fp, pmd, &pattern, &pattern_length) == -1)
             return -1;
 
-        /* create a rule_node */
-        RULE_NODE* rn = (RULE_NODE*)SnortAlloc(sizeof(RULE_NODE));
-        rn->rnRuleData = otn;
-
-        /* create pmx */
-        PMX* pmx = (PMX*)SnortAlloc(sizeof(PMX));
-        pmx->RuleNode = rn;
-        pmx->PatternMatchData = pmd;
-
         if (fp->get_debug_print_fast_patterns())
             PrintFastPatternInfo(otn, pmd, pattern, pattern_length);
 
-        if ( !pg->mpse[pmd->pm_type] )
-        {
-            pg->mpse[pmd->pm_type] = MpseManager::get_search_engine(
-                sc, fp->get_search_api(), true, fpDeletePMX,
-                free_detection_option_root, neg_list_free);
-
-            if ( !pg->mpse[pmd->pm_type] )
-            {
-                ParseError("Failed to create pattern matcher for %d\n", pmd->pm_type);
-                return -1;
-            }
-            mpse_count++;
-
-            if ( fp->get_search_opt() )
-                pg->mpse[pmd->pm_type]->set_opt(1);
-        }
-
-        pg->mpse[pmd->pm_type]->add_pattern(
-            sc, (uint8_t*)pattern, pattern_length, pmd->no_case, pmd->negated,
-            pmx, rn->iRuleNodeID);
+        // the engines are built when the group is finished
+        fp_patterns.push_back({ otn, pmd, pattern, pattern_length });
     }
 
     return 0;
@@ -656,35 +968,22 @@ static int fpFinishPortGroupRule(
 static int fpFinishPortGroup(
     SnortConfig* sc, PortGroup* pg, FastPatternConfig* fp)
 {
-    int i;
     int rules = 0;
 
     if ((pg == NULL) || (fp == NULL))
+    {
+        fp_patterns.clear();
         return -1;
+    }
 
-    for (i = PM_TYPE_PKT; i < PM_TYPE_MAX; i++)
+    if ( !fp_patterns.empty() )
     {
-        if (pg->mpse[i] != NULL)
-        {
-            if (pg->mpse[i]->get_pattern_count() != 0)
-            {
-                if (pg->mpse[i]->prep_patterns(sc, pmx_create_tree,
-                    add_patrn_to_neg_list) != 0)
-                {
-                    FatalError("%s(%d) Failed to compile port group "
-                        "patterns.\n", __FILE__, __LINE__);
-                }
+        pg->matchers = fp_get_matchers(sc, fp);
+        memcpy(pg->mpse, pg->matchers->mpse, sizeof(pg->mpse));
 
-                if (fp->get_debug_mode())
-                    pg->mpse[i]->print_info();
-                rules = 1;
-            }
-            else
-            {
-                MpseManager::delete_search_engine(pg->mpse[i]);
-                pg->mpse[i] = NULL;
-            }
-        }
+        fp_binds.push_back({ pg, std::move(fp_patterns) });
+        fp_patterns.clear();
+        rules = 1;
     }
 
     if ( pg->nfp_head )
@@ -1056,9 +1355,15 @@ static void fpPortGroupPrintRuleCount(PortGroup* pg, const char* what)
 
     LogMessage("PortGroup rule summary (%s):\n", what);
 
+    // the engines aren't built until the group is finished
+    unsigned counts[PM_TYPE_MAX] = { };
+
+    for ( auto& p : fp_patterns )
+        counts[p.pmd->pm_type]++;
+
     for (type = PM_TYPE_PKT; type < PM_TYPE_MAX; type++)
     {
-        int count = pg->mpse[type] ? pg->mpse[type]->get_pattern_count() : 0;
+        unsigned count = counts[type];
 
         if ( count )
             LogMessage("\t%s: %d\n", pm_type_strings[type], count);
@@ -1068,31 +1373,22 @@ static void fpPortGroupPrintRuleCount(PortGroup* pg, const char* what)
         LogMessage("\tNo content: %u\n", pg->nfp_rule_count);
 }
 
-static void fpDeletePMX(void* data)
-{
-    PMX* pmx = (PMX*)data;
-
-    if (data == NULL)
-        return;
-
-    if (pmx->RuleNode != NULL)
-        free(pmx->RuleNode);
-
-    free(pmx);
-}
-
 void fpDeletePortGroup(void* data)
 {
     PortGroup* pg = (PortGroup*)data;
     pg->delete_nfp_rules();
 
-    for (int i = PM_TYPE_PKT; i < PM_TYPE_MAX; i++)
+    if ( FpMatchers* fpm = pg->matchers )
     {
-        if (pg->mpse[i] != NULL)
-        {
-            MpseManager::delete_search_engine(pg->mpse[i]);
-            pg->mpse[i] = NULL;
-        }
+        for ( unsigned t = 0; t < fpm->trees.size(); ++t )
+            free_detection_option_root(&pg->trees[t]);
+
+        free(pg->trees);
+        free(pg->pmx[0].RuleNode);  // all in one block
+        free(pg->pmx);
+
+        fp_release_matchers(fpm);
+        pg->matchers = nullptr;
     }
 
     free_detection_option_root(&pg->nfp_tree);
@@ -1824,6 +2120,11 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     }
 
     mpse_count = 0;
+    groups_compiled = groups_shared = 0;
+
+    unsigned threads = fp_get_threads(fp);
+    FpClock::time_point start = FpClock::now();
+    double secs[FP_PHASE_MAX];
 
     MpseManager::start_search_engine(fp->get_search_api());
 
@@ -1837,6 +2138,8 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if (fp->get_debug_print_rule_group_build_details())
         LogMessage("Port Groups Done....\n");
 
+    secs[FP_PHASE_PORTS] = fp_get_secs(start);
+
     /* Create rule_maps */
     if (fp->get_debug_print_rule_group_build_details())
         LogMessage("Creating Rule Maps....\n");
@@ -1847,6 +2150,8 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if (fp->get_debug_print_rule_group_build_details())
         LogMessage("Rule Maps Done....\n");
 
+    secs[FP_PHASE_MAPS] = fp_get_secs(start);
+
     if (fp->get_debug_print_rule_group_build_details())
         LogMessage("Creating Service Based Rule Maps....\n");
 
@@ -1861,6 +2166,14 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if (fp->get_debug_print_rule_group_build_details())
         LogMessage("Service Based Rule Maps Done....\n");
 
+    secs[FP_PHASE_SERVICES] = fp_get_secs(start);
+
+    fp_compile_groups(sc, fp, threads);
+    secs[FP_PHASE_COMPILE] = fp_get_secs(start);
+
+    fp_build_groups(sc, threads);
+    secs[FP_PHASE_TREES] = fp_get_secs(start);
+
     fp_print_port_groups(port_tables);
     fp_print_service_groups(sc->spgmmTable);
 
@@ -1875,6 +2188,17 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if ( fp->get_num_patterns_trimmed() )
         LogMessage("%25.25s: %-12u\n", "prefix trims", fp->get_num_patterns_trimmed());
 
+    if ( groups_compiled || groups_shared )
+    {
+        LogMessage("%25.25s: %-12u\n", "compiled groups", groups_compiled);
+        LogMessage("%25.25s: %-12u\n", "shared groups", groups_shared);
+    }
+
+    LogMessage("%25.25s: %-12u\n", "compile threads", threads);
+
+    for ( unsigned i = 0; i < FP_PHASE_MAX; ++i )
+        LogMessage("%25.25s: %.3f\n", fp_phase_names[i], secs[i]);
+
     MpseManager::setup_search_engine(fp->get_search_api(), sc);
 
     return 0;
@@ -27,6 +27,8 @@
 
 // this is where rule groups are compiled and MPSE are instantiated
 
+#include <stdint.h>
+
 #include "detection/pcrm.h"
 #include "target_based/snort_protocols.h"
 
@@ -41,10 +43,18 @@ struct PMX
 /* Used for negative content list */
 struct NCListNode
 {
-    PMX* pmx;
+    void* id;
     NCListNode* next;
 };
 
+// the ids and trees passed to the match function by port group matchers
+// are 1 based indices into the group's tables
+inline PMX* fpGetPMX(PortGroup* pg, void* id)
+{ return pg->pmx + ((uintptr_t)id - 1); }
+
+inline void* fpGetTree(PortGroup* pg, void* tree)
+{ return pg->trees[(uintptr_t)tree - 1]; }
+
 /*
 **  This is the main routine to create a FastPacket inspection
 **  engine.  It reads in the snort list of RTNs and OTNs and
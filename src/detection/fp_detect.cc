@@ -365,7 +365,18 @@ int fpAddMatch(OTNX_MATCH_DATA* omd_local, int pLen, OptTreeNode* otn)
 **  FORMAL OUTPUT
 **    int - 1 if match, 0 if match failed.
 **
+**  NOTES
+**    Many OTNs share an RTN so the result is saved per packet in the
+**    RTN state.  Packets that are evaluated more than once with the
+**    same packet number but different headers aren't cached.
+**
 */
+static inline bool rtn_cacheable(Packet* p)
+{
+    return !(p->packet_flags & (PKT_ALLOW_MULTIPLE_DETECT | PKT_IP_RULE_2ND)) &&
+        !(p->proto_bits & (PROTO_BIT__TEREDO | PROTO_BIT__GTP));
+}
+
 int fpEvalRTN(RuleTreeNode* rtn, Packet* p, int check_ports)
 {
     PROFILE_VARS;
@@ -382,7 +393,49 @@ int fpEvalRTN(RuleTreeNode* rtn, Packet* p, int check_ports)
 
     DEBUG_WRAP(DebugMessage(DEBUG_DETECT, "[*] Rule Head %p\n", rtn); )
 
-    if (!rtn->rule_func->RuleHeadFunc(p, rtn, rtn->rule_func, check_ports))
+    pc.rtn_checks++;
+
+    RtnState* state = rtn->state + get_instance_id();
+    uint8_t bit = check_ports ? 0x2 : 0x1;
+    bool cacheable = rtn_cacheable(p);
+
+    uint64_t cur_eval_pkt_count =
+        (rule_eval_pkt_count + (PacketManager::get_rebuilt_packet_count()));
+
+    if ( cacheable &&
+        (state->packet_number == cur_eval_pkt_count) &&
+        (state->ts.tv_sec == p->pkth->ts.tv_sec) &&
+        (state->ts.tv_usec == p->pkth->ts.tv_usec) &&
+        (state->rebuild_flag == (p->packet_flags & PKT_REBUILT_STREAM)) &&
+        (state->valid & bit) )
+    {
+        pc.rtn_cache_hits++;
+        MODULE_PROFILE_END(ruleRTNEvalPerfStats);
+        return (state->result & bit) ? 1 : 0;
+    }
+
+    int rval = rtn->rule_func->RuleHeadFunc(p, rtn, rtn->rule_func, check_ports);
+
+    if ( cacheable )
+    {
+        if ( (state->packet_number != cur_eval_pkt_count) ||
+            (state->ts.tv_sec != p->pkth->ts.tv_sec) ||
+            (state->ts.tv_usec != p->pkth->ts.tv_usec) ||
+            (state->rebuild_flag != (p->packet_flags & PKT_REBUILT_STREAM)) )
+        {
+            state->ts.tv_sec = p->pkth->ts.tv_sec;
+            state->ts.tv_usec = p->pkth->ts.tv_usec;
+            state->packet_number = cur_eval_pkt_count;
+            state->rebuild_flag = (p->packet_flags & PKT_REBUILT_STREAM);
+            state->valid = state->result = 0;
+        }
+        state->valid |= bit;
+
+        if ( rval )
+            state->result |= bit;
+    }
+
+    if ( !rval )
     {
         DEBUG_WRAP(DebugMessage(DEBUG_DETECT,
             "   => Header check failed, checking next node\n"); );
@@ -471,9 +524,10 @@ static int detection_option_tree_evaluate(
 static int rule_tree_match(void* id, void* tree, int index, void* data, void* neg_list)
 {
     OTNX_MATCH_DATA* pomd   = (OTNX_MATCH_DATA*)data;
-    PMX* pmx    = (PMX*)id;
+    PMX* pmx    = fpGetPMX(pomd->pg, id);
     PatternMatchData* pmd    = (PatternMatchData*)pmx->PatternMatchData;
-    detection_option_tree_root_t* root = (detection_option_tree_root_t*)tree;
+    detection_option_tree_root_t* root =
+        (detection_option_tree_root_t*)fpGetTree(pomd->pg, tree);
     detection_option_eval_data_t eval_data;
     NCListNode* ncl;
     int rval=0;
@@ -494,7 +548,7 @@ static int rule_tree_match(void* id, void* tree, int index, void* data, void* ne
     /* Set flag for not contents so they aren't evaluated */
     for (ncl = (NCListNode*)neg_list; ncl != nullptr; ncl = ncl->next)
     {
-        PMX* neg_pmx = (PMX*)ncl->pmx;
+        PMX* neg_pmx = fpGetPMX(pomd->pg, ncl->id);
         PatternMatchData* neg_pmd = (PatternMatchData*)neg_pmx->PatternMatchData;
 
         assert(neg_pmd->last_check);
@@ -875,13 +929,34 @@ static inline int fpFinalSelectEvent(OTNX_MATCH_DATA* o, Packet* p)
 #define CHECK_PPM()
 #endif
 
+// with search_batch the buffers are collected and then searched with one
+// search_batch() per mpse so the engine can overlap the walks and defer
+// tree evaluation.  otherwise each buffer is searched as it is found.
+#define MAX_SEARCHES 6
+
+struct SearchBatch
+{
+    Mpse* so[MAX_SEARCHES];
+    MpseBatchItem items[MAX_SEARCHES];
+    unsigned num;
+};
+
 #define SEARCH_DATA(buf, len, cnt) \
     { \
         assert(so->get_pattern_count() > 0); \
-        int start_state = 0; \
         cnt++; \
-        so->search(buf, len, rule_tree_match, omd, &start_state); \
-        CHECK_PPM() \
+        if ( batch ) \
+        { \
+            assert(batch->num < MAX_SEARCHES); \
+            batch->so[batch->num] = so; \
+            batch->items[batch->num++] = { buf, (int)(len), omd, 0, false }; \
+        } \
+        else \
+        { \
+            int start_state = 0; \
+            so->search(buf, len, rule_tree_match, omd, &start_state); \
+            CHECK_PPM() \
+        } \
     }
 
 #define SEARCH_BUFFER(ibt, pmt, cnt) \
@@ -895,12 +970,51 @@ static inline int fpFinalSelectEvent(OTNX_MATCH_DATA* o, Packet* p)
     if ( len ) \
         SEARCH_DATA(buf, len, cnt)
 
+static void search_batch(SearchBatch& batch)
+{
+    for ( unsigned i = 0; i < batch.num; ++i )
+    {
+        Mpse* so = batch.so[i];
+
+        if ( !so )
+            continue;
+
+        MpseBatchItem items[MAX_SEARCHES];
+        unsigned num = 0;
+
+        for ( unsigned j = i; j < batch.num; ++j )
+        {
+            if ( batch.so[j] == so )
+            {
+                items[num++] = batch.items[j];
+                batch.so[j] = nullptr;
+            }
+        }
+        so->search_batch(items, num, rule_tree_match);
+    }
+}
+
 static int fp_search(
     PortGroup* port_group, Packet* p,
     int check_ports, int type, OTNX_MATCH_DATA* omd)
 {
     Inspector* gadget = p->flow ? p->flow->gadget : nullptr;
     InspectionBuffer buf;
+    SearchBatch sb;
+    SearchBatch* batch = nullptr;
+
+    // the ppm abort is checked after each buffer so batching is only
+    // done without ppm
+    if ( snort_conf->fast_pattern_config->get_search_batch() )
+    {
+#ifdef PPM_MGR
+        if ( !PPM_ENABLED() )
+#endif
+        {
+            sb.num = 0;
+            batch = &sb;
+        }
+    }
 
     omd->pg = port_group;
     omd->p = p;
@@ -948,6 +1062,10 @@ static int fp_search(
             SEARCH_PACKET(g_file_data.data, g_file_data.len, pc.file_searches);
         }
     }
+
+    if ( batch )
+        search_batch(*batch);
+
     return 0;
 }
 
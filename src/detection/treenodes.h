@@ -136,6 +136,17 @@ struct RuleFpList
     RuleFpList* next;
 };
 
+// header check result for the last packet (per thread) so that it
+// isn't redone for each OTN sharing the RTN
+struct RtnState
+{
+    struct timeval ts;
+    uint64_t packet_number;
+    uint32_t rebuild_flag;
+    uint8_t valid;   // bit n set if result is known for check_ports n
+    uint8_t result;  // bit n set if the header matched for check_ports n
+};
+
 // one of these per rule per policy
 // represents head part of rule
 struct RuleTreeNode
@@ -156,6 +167,8 @@ struct RuleTreeNode
 
     RuleType type;
 
+    RtnState* state;
+
     // reference count from otn.
     // Multiple OTNs can reference this RTN with the same policy.
     unsigned int otnRefCount;
@@ -282,6 +282,7 @@ typedef void (*Render_block_verdict_func)(void* ctx, Packet* p);
 typedef FileCaptureState (*Reserve_file_func)(Flow* flow, FileCaptureInfo** file_mem);
 typedef FileCaptureInfo* (*Get_file_func)(FileCaptureInfo* file_mem, uint8_t** buff, int* size);
 typedef void (*Release_file_func)(FileCaptureInfo* data);
+typedef bool (*Store_file_func)(FileCaptureInfo* data, const uint8_t* sha256);
 typedef size_t (*File_capture_size_func)(FileCaptureInfo* file_mem);
 
 typedef bool (*Is_file_service_enabled)();
@@ -575,6 +576,22 @@ typedef struct _file_api
      */
     Release_file_func release_file;
 
+    /*
+     * Write the file that is reserved in memory to the capture directory.
+     * The file is released by the capture writer thread once it is on disk,
+     * or right away if it is dropped because the writer is behind.
+     * The file must not be used after this call.
+     *
+     * Arguments:
+     *   void *data: the memory block that stores file and its metadata
+     *   uint8_t *sha256: file signature, used as the file name
+     *
+     * Returns:
+     *   true: file is queued to be written
+     *   false: file is dropped
+     */
+    Store_file_func store_file;
+
     /* Return the file rule id associated with a session.
      *
      * Arguments:
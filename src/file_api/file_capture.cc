@@ -43,10 +43,20 @@
 
 #include "hash/hashes.h"
 #include "main/snort_config.h"
+#include "main/thread.h"
 #include <unistd.h>
 #include <string.h>
 #include <fcntl.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <errno.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
 
 // FIXIT-L these are no longer needed
 #define SHA256CONTEXT SHA256_CTX
@@ -54,9 +64,48 @@
 #define SHA256UPDATE  SHA256_Update
 #define SHA256FINAL   SHA256_Final
 
-FileMemPool* file_mempool = NULL;
+//-------------------------------------------------------------------------
+// per thread pools
+// -- each packet thread allocates from and frees to its own FileMemPool so
+//    the free list only ever has one thread on it
+// -- a reserved file may be released from any thread so released chains
+//    go on a lock free stack, linked through the head block's last pointer,
+//    instead of the pool's release list; the owner takes the whole stack
+//    back when it next allocates and when it exits
+//-------------------------------------------------------------------------
+
+struct FileCapturePool
+{
+    FileCapturePool() : released(nullptr)
+    { memset(&mempool, 0, sizeof(mempool)); }
+
+    FileMemPool mempool;
+    std::atomic<FileCaptureInfo*> released;
+};
+
+class FileCaptureWriter;
+
+static FileCapturePool* capture_pools = nullptr;  // one per packet thread
+static unsigned num_capture_pools = 0;
+static THREAD_LOCAL FileCapturePool* capture_pool = nullptr;
+
+static FileCaptureWriter* capture_writer = nullptr;
+
+// packet threads count in their own stats, summed into file_capture_stats
+// when they exit.  the writer counts under its lock.
+static THREAD_LOCAL File_Capture_Stats capture_stats;
+static std::mutex capture_stats_lock;
+
 File_Capture_Stats file_capture_stats;
 
+static inline FileCapturePool* get_capture_pool()
+{
+    if (!capture_pool && capture_pools)
+        capture_pool = capture_pools + (get_instance_id() % num_capture_pools);
+
+    return capture_pool;
+}
+
 /*
  * Verify file capture information and file context information matched
  * This is used for debug purpose
@@ -123,42 +172,41 @@ static void verifiy_file_capture(FileContext* context,
 #endif
 
 /*
- * Initialize the file memory pool
+ * Initialize one packet thread's share of the file memory pool
  *
- * Returns:
- *   void *: pointer to mempool
- *   NULL  : fail to initialize file mempool
+ * Arguments:
+ *    FileMemPool *file_mempool: pool to initialize
+ *    int64_t max_file_mem: memcap in megabytes
+ *    int64_t block_size:  file block size (metadata size included)
+ *    unsigned shares: number of pools the memcap is split between
+ *
+ * Returns: NONE
  */
-static FileMemPool* _init_file_mempool(int64_t max_file_mem, int64_t block_size)
+static void _init_file_mempool(FileMemPool* file_mempool, int64_t max_file_mem,
+    int64_t block_size, unsigned shares)
 {
-    int max_files;
-    FileMemPool* file_mempool;
+    int64_t max_files;
     int64_t max_file_mem_in_bytes;
 
     /*Convert megabytes to bytes*/
     max_file_mem_in_bytes = max_file_mem * 1024 * 1024;
 
-    if (block_size <= 0)
-        return NULL;
-
     if (block_size & 7)
         block_size += (8 - (block_size & 7));
 
-    max_files = max_file_mem_in_bytes / block_size;
+    max_files = max_file_mem_in_bytes / shares / block_size;
 
-    file_mempool = (FileMemPool*)calloc(1, sizeof(FileMemPool));
+    if (max_files < 1)
+        max_files = 1;
 
-    if ((!file_mempool)||
-        (file_mempool_init(file_mempool, max_files, block_size) != 0))
+    if (file_mempool_init(file_mempool, max_files, block_size) != 0)
     {
         FatalError("File capture: Could not allocate file buffer mempool.\n");
     }
-
-    return file_mempool;
 }
 
 /*
- * Initialize the file memory pool
+ * Initialize the file memory pools, one per packet thread
  *
  * Arguments:
  *    int64_t max_file_mem: memcap in megabytes
@@ -170,37 +218,75 @@ void file_capture_init_mempool(int64_t max_file_mem, int64_t block_size)
 {
     int64_t metadata_size = sizeof (FileCaptureInfo);
 
-    file_mempool = _init_file_mempool(max_file_mem, block_size + metadata_size);
+    if (block_size <= 0)
+        return;
+
+    num_capture_pools = get_instance_max();
+    capture_pools = new FileCapturePool[num_capture_pools];
+
+    for (unsigned i = 0; i < num_capture_pools; i++)
+    {
+        _init_file_mempool(&capture_pools[i].mempool, max_file_mem,
+            block_size + metadata_size, num_capture_pools);
+    }
 }
 
-/* Free file buffer list*/
+/* Free file buffer list, only called by the owning packet thread*/
 static inline void _free_file_buffer(FileCaptureInfo* fileInfo)
 {
-    file_capture_stats.files_freed_total++;
+    FileMemPool* file_mempool = &fileInfo->pool->mempool;
+
+    capture_stats.files_freed_total++;
 
     while (fileInfo)
     {
+        FileCaptureInfo* next = fileInfo->next;
+
         if (file_mempool_free(file_mempool, fileInfo) != FILE_MEM_SUCCESS)
-            file_capture_stats.file_buffers_free_errors++;
-        fileInfo = fileInfo->next;
-        file_capture_stats.file_buffers_freed_total++;
+            capture_stats.file_buffers_free_errors++;
+        fileInfo = next;
+        capture_stats.file_buffers_freed_total++;
     }
 }
 
-/* Release file buffer list*/
-static inline void _release_file_buffer(FileCaptureInfo* fileInfo)
+/* Return the files released by any thread to the owner's free list*/
+static void _reclaim_file_buffers(FileCapturePool* pool)
 {
-    file_capture_stats.files_released_total++;
+    FileCaptureInfo* fileInfo =
+        pool->released.exchange(nullptr, std::memory_order_acquire);
 
     while (fileInfo)
     {
-        if (file_mempool_release(file_mempool, fileInfo) != FILE_MEM_SUCCESS)
-            file_capture_stats.file_buffers_release_errors++;
-        fileInfo = fileInfo->next;
-        file_capture_stats.file_buffers_released_total++;
+        FileCaptureInfo* next_file = fileInfo->last;
+
+        capture_stats.files_released_total++;
+
+        while (fileInfo)
+        {
+            FileCaptureInfo* next = fileInfo->next;
+
+            if (file_mempool_free(&pool->mempool, fileInfo) != FILE_MEM_SUCCESS)
+                capture_stats.file_buffers_release_errors++;
+            fileInfo = next;
+            capture_stats.file_buffers_released_total++;
+        }
+        fileInfo = next_file;
     }
 }
 
+/* Release file buffer list, this might be called in any thread*/
+static inline void _release_file_buffer(FileCaptureInfo* fileInfo)
+{
+    FileCapturePool* pool = fileInfo->pool;
+    FileCaptureInfo* top = pool->released.load(std::memory_order_relaxed);
+
+    /* The last block isn't needed any more, so reuse it to link files*/
+    do
+        fileInfo->last = top;
+    while (!pool->released.compare_exchange_weak(top, fileInfo,
+        std::memory_order_release, std::memory_order_relaxed));
+}
+
 /*
  * Stop file capture, memory resource will be released if not reserved
  *
@@ -227,37 +313,43 @@ void file_capture_stop(FileContext* context)
  * Create file buffer in file mempool
  *
  * Args:
- *   FileMemPool *file_mempool: file mempool
- *   FileContext* context: file context
+ *   FileCapturePool *pool: this packet thread's pool
  *
  * Returns:
  *   FileCaptureInfo *: memory block that starts with file capture information
  */
-static inline FileCaptureInfo* _create_file_buffer(FileMemPool* file_mempool)
+static inline FileCaptureInfo* _create_file_buffer(FileCapturePool* pool)
 {
-    FileCaptureInfo* fileInfo;
+    FileCaptureInfo* fileInfo = NULL;
     uint64_t num_files_queued;
 
-    fileInfo = (FileCaptureInfo*)file_mempool_alloc(file_mempool);
+    if (pool)
+    {
+        if (pool->released.load(std::memory_order_relaxed))
+            _reclaim_file_buffers(pool);
+
+        fileInfo = (FileCaptureInfo*)file_mempool_alloc(&pool->mempool);
+    }
 
     if (fileInfo == NULL)
     {
         FILE_DEBUG_MSGS("Failed to get file capture memory!\n");
-        file_capture_stats.file_memcap_failures_total++;
+        capture_stats.file_memcap_failures_total++;
         return NULL;
     }
 
-    file_capture_stats.file_buffers_allocated_total++;
+    capture_stats.file_buffers_allocated_total++;
 
     fileInfo->length = 0;
     fileInfo->reserved = false;
     fileInfo->next = NULL;     /*Only one block initially*/
     fileInfo->last = fileInfo;
     fileInfo->file_size = 0;
+    fileInfo->pool = pool;
 
-    num_files_queued = file_mempool_allocated(file_mempool);
-    if (file_capture_stats.file_buffers_used_max < num_files_queued)
-        file_capture_stats.file_buffers_used_max = num_files_queued;
+    num_files_queued = file_mempool_allocated(&pool->mempool);
+    if (capture_stats.file_buffers_used_max < num_files_queued)
+        capture_stats.file_buffers_used_max = num_files_queued;
 
     return fileInfo;
 }
@@ -271,7 +363,7 @@ static inline FileCaptureInfo* _create_file_buffer(FileMemPool* file_mempool)
  *   0: successful or file capture is disabled
  *   1: fail to capture the file
  */
-static inline int _save_to_file_buffer(FileMemPool* file_mempool,
+static inline int _save_to_file_buffer(FileCapturePool* pool,
     FileContext* context, uint8_t* file_data, int data_size,
     int64_t max_size)
 {
@@ -285,7 +377,7 @@ static inline int _save_to_file_buffer(FileMemPool* file_mempool,
     if ( data_size + (signed)fileInfo->file_size > max_size)
     {
         FILE_DEBUG_MSGS("Exceeding max file capture size!\n");
-        file_capture_stats.file_size_exceeded++;
+        capture_stats.file_size_exceeded++;
         context->file_state.capture_state = FILE_CAPTURE_MAX;
         return -1;
     }
@@ -310,7 +402,7 @@ static inline int _save_to_file_buffer(FileMemPool* file_mempool,
         while (1)
         {
             /*get another block*/
-            new_block = (FileCaptureInfo*)_create_file_buffer(file_mempool);
+            new_block = (FileCaptureInfo*)_create_file_buffer(pool);
 
             if (new_block == NULL)
             {
@@ -380,7 +472,7 @@ int file_capture_process(FileContext* context, uint8_t* file_data,
     switch (position)
     {
     case SNORT_FILE_FULL:
-        file_capture_stats.file_within_packet++;
+        capture_stats.file_within_packet++;
         break;
     case SNORT_FILE_END:
         break;
@@ -393,7 +485,7 @@ int file_capture_process(FileContext* context, uint8_t* file_data,
 
         if (!context->file_capture)
         {
-            fileInfo  = _create_file_buffer(file_mempool);
+            fileInfo  = _create_file_buffer(get_capture_pool());
 
             if (!fileInfo)
             {
@@ -402,7 +494,7 @@ int file_capture_process(FileContext* context, uint8_t* file_data,
                 return -1;
             }
 
-            file_capture_stats.files_buffered_total++;
+            capture_stats.files_buffered_total++;
 
             context->file_capture = fileInfo;
         }
@@ -412,7 +504,7 @@ int file_capture_process(FileContext* context, uint8_t* file_data,
             return -1;
         }
 
-        if (_save_to_file_buffer(file_mempool, context, file_data, data_size,
+        if (_save_to_file_buffer(get_capture_pool(), context, file_data, data_size,
                 file_config->file_capture_max_size))
         {
             FILE_DEBUG_MSGS("Can't save to file buffer!\n");
@@ -426,7 +518,7 @@ int file_capture_process(FileContext* context, uint8_t* file_data,
 /*Helper function for error*/
 static inline FileCaptureState ERROR_capture(FileCaptureState state)
 {
-    file_capture_stats.file_reserve_failures++;
+    capture_stats.file_reserve_failures++;
     return state;
 }
 
@@ -476,13 +568,13 @@ FileCaptureState file_capture_reserve(Flow* flow, FileCaptureInfo** file_mem)
 
     if ( fileSize < (unsigned)file_config->file_capture_min_size)
     {
-        file_capture_stats.file_size_min++;
+        capture_stats.file_size_min++;
         return ERROR_capture(FILE_CAPTURE_MIN);
     }
 
     if ( fileSize > (unsigned)file_config->file_capture_max_size)
     {
-        file_capture_stats.file_size_max++;
+        capture_stats.file_size_max++;
         return ERROR_capture(FILE_CAPTURE_MAX);
     }
 
@@ -491,15 +583,15 @@ FileCaptureState file_capture_reserve(Flow* flow, FileCaptureInfo** file_mem)
      */
     if (!fileInfo && context->file_capture_enabled)
     {
-        fileInfo  = _create_file_buffer(file_mempool);
+        fileInfo  = _create_file_buffer(get_capture_pool());
 
         if (!fileInfo)
         {
-            file_capture_stats.file_memcap_failures_reserve++;
+            capture_stats.file_memcap_failures_reserve++;
             return ERROR_capture(FILE_CAPTURE_MEMCAP);
         }
 
-        file_capture_stats.files_buffered_total++;
+        capture_stats.files_buffered_total++;
         context->file_capture = fileInfo;
 
         DEBUG_WRAP(verify_file_capture_info(context, fileInfo); );
@@ -513,13 +605,13 @@ FileCaptureState file_capture_reserve(Flow* flow, FileCaptureInfo** file_mem)
     DEBUG_WRAP(verify_file_capture_info(context, fileInfo); );
 
     /*Copy the last piece of file to file buffer*/
-    if (_save_to_file_buffer(file_mempool, context, context->current_data,
+    if (_save_to_file_buffer(get_capture_pool(), context, context->current_data,
             context->current_data_len, file_config->file_capture_max_size) )
     {
         return ERROR_capture(context->file_state.capture_state);
     }
 
-    file_capture_stats.files_captured_total++;
+    capture_stats.files_captured_total++;
 
     *file_mem = fileInfo;
 
@@ -597,20 +689,320 @@ void file_capture_release(FileCaptureInfo* fileInfo)
     _release_file_buffer(fileInfo);
 }
 
+//-------------------------------------------------------------------------
+// capture writer
+// -- packet threads queue reserved files with file_capture_store(); the
+//    blocks aren't copied, the queue just holds the chains
+// -- the writer thread writes each file with writev() over its blocks so
+//    it goes out in a few large sequential writes, then releases it back
+//    to the owning pool
+// -- queued files hold pool memory so the queue is capped in bytes; a file
+//    that doesn't fit is dropped rather than making the packet thread wait
+//-------------------------------------------------------------------------
+
+#define FILE_STORE_IOVS 64
+
+struct FileStoreRequest
+{
+    FileCaptureInfo* file;
+    uint8_t sha256[SHA256_HASH_SIZE];
+};
+
+class FileCaptureWriter
+{
+public:
+    FileCaptureWriter(const char* dir, uint64_t max_queued);
+    ~FileCaptureWriter();
+
+    bool put(FileCaptureInfo*, const uint8_t* sha256);
+
+private:
+    void run();
+    bool write(const FileStoreRequest&);
+
+private:
+    std::string dir;
+    uint64_t max_queued;
+    uint64_t queued;  // bytes
+    std::deque<FileStoreRequest> requests;
+    bool done;
+
+    std::mutex lock;
+    std::condition_variable data_ready;
+    std::thread* writer;
+};
+
+FileCaptureWriter::FileCaptureWriter(const char* d, uint64_t max) : dir(d)
+{
+    max_queued = max;
+    queued = 0;
+    done = false;
+    writer = new std::thread(&FileCaptureWriter::run, this);
+}
+
+FileCaptureWriter::~FileCaptureWriter()
+{
+    lock.lock();
+    done = true;
+    lock.unlock();
+
+    data_ready.notify_one();
+    writer->join();
+
+    delete writer;
+}
+
+bool FileCaptureWriter::put(FileCaptureInfo* fileInfo, const uint8_t* sha256)
+{
+    std::lock_guard<std::mutex> lg(lock);
+
+    if (queued + fileInfo->file_size > max_queued)
+    {
+        file_capture_stats.files_store_dropped++;
+        return false;
+    }
+
+    FileStoreRequest req;
+    req.file = fileInfo;
+    memcpy(req.sha256, sha256, sizeof(req.sha256));
+    requests.push_back(req);
+
+    queued += fileInfo->file_size;
+
+    if (file_capture_stats.file_store_queued_max < queued)
+        file_capture_stats.file_store_queued_max = queued;
+
+    data_ready.notify_one();
+    return true;
+}
+
+void FileCaptureWriter::run()
+{
+    std::unique_lock<std::mutex> ul(lock);
+
+    while (true)
+    {
+        data_ready.wait(ul, [&]{ return done || !requests.empty(); });
+
+        /* Whatever was queued before shutdown is still written*/
+        if (requests.empty())
+            break;
+
+        FileStoreRequest req = requests.front();
+        requests.pop_front();
+        ul.unlock();
+
+        uint64_t size = req.file->file_size;
+        bool stored = write(req);
+
+        file_capture_release(req.file);
+        ul.lock();
+
+        queued -= size;
+
+        if (stored)
+        {
+            file_capture_stats.files_stored_total++;
+            file_capture_stats.file_store_bytes += size;
+        }
+        else
+            file_capture_stats.files_store_errors++;
+    }
+}
+
+static bool _writev_all(int fd, struct iovec* iov, int cnt)
+{
+    while (cnt > 0)
+    {
+        ssize_t rv = writev(fd, iov, cnt);
+
+        if (rv < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        /* Skip what was written, leaving the remainder in iov[0 .. cnt-1]*/
+        while (cnt > 0 && (size_t)rv >= iov[0].iov_len)
+        {
+            rv -= iov[0].iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0)
+        {
+            iov[0].iov_base = (uint8_t*)iov[0].iov_base + rv;
+            iov[0].iov_len -= rv;
+        }
+    }
+    return true;
+}
+
+bool FileCaptureWriter::write(const FileStoreRequest& req)
+{
+    char name[2 * SHA256_HASH_SIZE + 1];
+
+    for (int i = 0; i < SHA256_HASH_SIZE; i++)
+        snprintf(name + 2 * i, 3, "%02X", req.sha256[i]);
+
+    std::string path = dir + "/" + name;
+
+    /* Same signature means same file, so it is already on disk*/
+    if (access(path.c_str(), F_OK) == 0)
+        return true;
+
+    /* Write to a temporary file so that a partial file is never seen*/
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        if (!file_capture_stats.files_store_errors)
+            ErrorMessage("File capture: can't create %s: %s\n",
+                tmp.c_str(), get_error(errno));
+        return false;
+    }
+
+    FileCaptureInfo* fileInfo = req.file;
+    struct iovec iov[FILE_STORE_IOVS];
+    bool ok = true;
+
+    while (fileInfo && ok)
+    {
+        int cnt = 0;
+
+        while (fileInfo && cnt < FILE_STORE_IOVS)
+        {
+            iov[cnt].iov_base = (uint8_t*)fileInfo + sizeof(*fileInfo);
+            iov[cnt++].iov_len = fileInfo->length;
+            fileInfo = fileInfo->next;
+        }
+        ok = _writev_all(fd, iov, cnt);
+    }
+
+    if (close(fd) || !ok || rename(tmp.c_str(), path.c_str()))
+    {
+        if (!file_capture_stats.files_store_errors)
+            ErrorMessage("File capture: can't write %s: %s\n",
+                path.c_str(), get_error(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Start the writer thread that stores captured files to disk
+ *
+ * Arguments:
+ *    const char* dir: directory the files are written to
+ *    int64_t max_queued_mem: megabytes that may wait to be written
+ */
+void file_capture_init_writer(const char* dir, int64_t max_queued_mem)
+{
+    struct stat st;
+
+    if (stat(dir, &st) || !S_ISDIR(st.st_mode))
+        FatalError("File capture: %s is not a directory.\n", dir);
+
+    capture_writer = new FileCaptureWriter(dir, max_queued_mem * 1024 * 1024);
+}
+
+/*
+ * Write the file that is reserved in memory to disk from the writer thread,
+ * which releases it when done.  The file is released right away if it can't
+ * be queued.
+ *
+ * Arguments:
+ *   FileCaptureInfo *fileInfo: the first memory block of the file
+ *   const uint8_t *sha256: file signature, used as the file name
+ *
+ * Returns:
+ *   true: the file is queued
+ *   false: the file is dropped
+ */
+bool file_capture_store(FileCaptureInfo* fileInfo, const uint8_t* sha256)
+{
+    if (!fileInfo)
+        return false;
+
+    if (capture_writer && sha256 && capture_writer->put(fileInfo, sha256))
+        return true;
+
+    file_capture_release(fileInfo);
+    return false;
+}
+
+/*
+ * Add this packet thread's counts to the totals,
+ * this must be called when the packet thread exits
+ */
+void file_capture_tterm(void)
+{
+    /* Count the files released since this thread last allocated*/
+    if (capture_pool)
+        _reclaim_file_buffers(capture_pool);
+
+    std::lock_guard<std::mutex> lg(capture_stats_lock);
+    File_Capture_Stats& sum = file_capture_stats;
+
+    sum.files_buffered_total += capture_stats.files_buffered_total;
+    sum.files_released_total += capture_stats.files_released_total;
+    sum.files_freed_total += capture_stats.files_freed_total;
+    sum.files_captured_total += capture_stats.files_captured_total;
+    sum.file_memcap_failures_total += capture_stats.file_memcap_failures_total;
+    sum.file_memcap_failures_reserve += capture_stats.file_memcap_failures_reserve;
+    sum.file_reserve_failures += capture_stats.file_reserve_failures;
+    sum.file_size_exceeded += capture_stats.file_size_exceeded;
+    sum.file_size_min += capture_stats.file_size_min;
+    sum.file_size_max += capture_stats.file_size_max;
+    sum.file_within_packet += capture_stats.file_within_packet;
+    sum.file_buffers_allocated_total += capture_stats.file_buffers_allocated_total;
+    sum.file_buffers_freed_total += capture_stats.file_buffers_freed_total;
+    sum.file_buffers_released_total += capture_stats.file_buffers_released_total;
+    sum.file_buffers_free_errors += capture_stats.file_buffers_free_errors;
+    sum.file_buffers_release_errors += capture_stats.file_buffers_release_errors;
+
+    if (sum.file_buffers_used_max < capture_stats.file_buffers_used_max)
+        sum.file_buffers_used_max = capture_stats.file_buffers_used_max;
+
+    memset(&capture_stats, 0, sizeof(capture_stats));
+}
+
 /*Log file capture mempool usage*/
 void file_capture_mem_usage(void)
 {
-    if (file_mempool)
+    uint64_t total = 0, allocated = 0, freed = 0, released = 0;
+
+    if (!capture_pools)
+        return;
+
+    for (unsigned i = 0; i < num_capture_pools; i++)
     {
-        LogMessage("Maximum buffers can allocate:      " FMTu64("-10") " \n",
-            file_mempool->total);
-        LogMessage("Number of buffers in use:          " FMTu64("-10") " \n",
-            file_mempool_allocated(file_mempool));
-        LogMessage("Number of buffers in free list:    " FMTu64("-10") " \n",
-            file_mempool_freed(file_mempool));
-        LogMessage("Number of buffers in release list: " FMTu64("-10") " \n",
-            file_mempool_released(file_mempool));
+        FileMemPool* file_mempool = &capture_pools[i].mempool;
+
+        total += file_mempool->total;
+        allocated += file_mempool_allocated(file_mempool);
+        freed += file_mempool_freed(file_mempool);
+
+        /* The owners have exited, so nothing is taken off the stacks now*/
+        FileCaptureInfo* fileInfo =
+            capture_pools[i].released.load(std::memory_order_acquire);
+
+        for (; fileInfo; fileInfo = fileInfo->last)
+        {
+            for (FileCaptureInfo* block = fileInfo; block; block = block->next)
+                released++;
+        }
     }
+
+    LogMessage("Number of buffer pools:            %-10u \n", num_capture_pools);
+    LogMessage("Maximum buffers can allocate:      " FMTu64("-10") " \n", total);
+    LogMessage("Number of buffers in use:          " FMTu64("-10") " \n", allocated);
+    LogMessage("Number of buffers in free list:    " FMTu64("-10") " \n", freed);
+    LogMessage("Number of buffers in release list: " FMTu64("-10") " \n", released);
 }
 
 /*
@@ -619,10 +1011,23 @@ void file_capture_mem_usage(void)
  */
 void file_caputure_close(void)
 {
-    if (file_mempool_destroy(file_mempool) == 0)
-    {
-        free(file_mempool);
-        file_mempool = NULL;
-    }
-}
+    /* Stop the writer first, it releases what it still holds*/
+    delete capture_writer;
+    capture_writer = nullptr;
+
+    if (!capture_pools)
+        return;
+
+    /* Count what was released after the packet threads exited*/
+    for (unsigned i = 0; i < num_capture_pools; i++)
+        _reclaim_file_buffers(&capture_pools[i]);
+
+    file_capture_tterm();
 
+    for (unsigned i = 0; i < num_capture_pools; i++)
+        file_mempool_destroy(&capture_pools[i].mempool);
+
+    delete[] capture_pools;
+    capture_pools = nullptr;
+    num_capture_pools = 0;
+}
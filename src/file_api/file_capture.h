@@ -30,10 +30,19 @@
 //     data will stay in the mempool.
 // 3) Then file data can be read through file_capture_read()
 // 4) Finally, fila data must be released from mempool file_capture_release()
+//    or handed to file_capture_store() which writes it to disk and releases
+//    it from the capture writer thread.
+//
+// Each packet thread captures into its own mempool, sized to its share of
+// the memcap, so allocation and free never contend.  A reserved file may be
+// released by any thread; released blocks are pushed back to the owning
+// pool and reclaimed by its packet thread the next time it allocates.
 
 #include "file_api.h"
 #include "libs/file_lib.h"
 
+struct FileCapturePool;
+
 struct FileCaptureInfo
 {
     uint32_t length;
@@ -41,6 +50,7 @@ struct FileCaptureInfo
     FileCaptureInfo* last;  /* last block of file data */
     FileCaptureInfo* next;  /* next block of file data */
     uint64_t file_size; /*file_size*/
+    FileCapturePool* pool;  /* owning packet thread's pool */
 };
 
 typedef struct _File_Capture_Stats
@@ -62,13 +72,24 @@ typedef struct _File_Capture_Stats
     uint64_t file_buffers_released_total;
     uint64_t file_buffers_free_errors;
     uint64_t file_buffers_release_errors;
+    uint64_t files_stored_total;           /*Written to disk by the writer*/
+    uint64_t files_store_dropped;          /*Writer queue was full*/
+    uint64_t files_store_errors;
+    uint64_t file_store_bytes;
+    uint64_t file_store_queued_max;        /*Maximum bytes waiting to be written*/
 } File_Capture_Stats;
 
 extern File_Capture_Stats file_capture_stats;
 
-// this must be called during snort init
+// this must be called during snort init; the memcap is split evenly
+// between the packet threads
 void file_capture_init_mempool(int64_t max_file_mem, int64_t block_size);
 
+// start the capture writer thread; files passed to file_capture_store()
+// are written to dir, named by their SHA256.  at most max_queued_mem
+// megabytes of captured data may be waiting to be written.
+void file_capture_init_writer(const char* dir, int64_t max_queued_mem);
+
 // Capture file data to local buffer
 // This is the main function call to enable file capture
 // Returns:
@@ -100,6 +121,17 @@ size_t file_capture_size(FileCaptureInfo* file_mem);
 // called in a different thread.
 void file_capture_release(FileCaptureInfo* data);
 
+// Queue a reserved file for the writer thread, which releases it once it is
+// on disk.  This never blocks on i/o: if the writer isn't running or too much
+// data is already queued the file is released right away and false returned.
+// Either way the caller must not use file_mem afterwards.
+bool file_capture_store(FileCaptureInfo* file_mem, const uint8_t* sha256);
+
+// Add the calling packet thread's counts to file_capture_stats,
+// this must be called when the packet thread exits after the
+// inspectors (and so the flows holding files) are terminated
+void file_capture_tterm(void);
+
 // Log file capture mempool usage
 void file_capture_mem_usage(void);
 
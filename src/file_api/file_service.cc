@@ -193,6 +193,7 @@ void init_fileAPI(void)
     fileAPI.reserve_file = &file_capture_reserve;
     fileAPI.read_file = &file_capture_read;
     fileAPI.release_file = &file_capture_release;
+    fileAPI.store_file = &file_capture_store;
     fileAPI.get_file_capture_size = &file_capture_size;
     fileAPI.get_file_type_id = &get_file_type_id;
     fileAPI.get_new_file_instance = &get_new_file_instance;
@@ -227,9 +228,15 @@ void FileAPIPostInit(void)
     }
 
     if ( file_capture_enabled)
+    {
         file_capture_init_mempool(file_config->file_capture_memcap,
             file_config->file_capture_block_size);
 
+        if ( !file_config->file_capture_dir.empty() )
+            file_capture_init_writer(file_config->file_capture_dir.c_str(),
+                file_config->file_capture_queue_size);
+    }
+
     //file_sevice_reconfig_set(false);
 }
 
@@ -346,6 +346,16 @@ void print_file_stats()
             "-10") " \n", file_capture_stats.file_size_max);
     LogMessage("Total capture max before reserve:  " FMTu64(
             "-10") " \n", file_capture_stats.file_size_exceeded);
+    LogMessage("Total files stored:                " FMTu64(
+            "-10") " \n", file_capture_stats.files_stored_total);
+    LogMessage("Total files store dropped:         " FMTu64(
+            "-10") " \n", file_capture_stats.files_store_dropped);
+    LogMessage("Total files store errors:          " FMTu64(
+            "-10") " \n", file_capture_stats.files_store_errors);
+    LogMessage("Total bytes stored:                " FMTu64(
+            "-10") " \n", file_capture_stats.file_store_bytes);
+    LogMessage("Maximum bytes queued to store:     " FMTu64(
+            "-10") " \n", file_capture_stats.file_store_queued_max);
     LogMessage("Total file signature max:          " FMTu64(
             "-10") " \n", file_stats.files_sig_depth);
 
@@ -24,6 +24,8 @@
 
 // This provides the basic configuration for file processing
 
+#include <string>
+
 #include "file_lib.h"
 #include "file_identifier.h"
 
@@ -36,6 +38,7 @@
 #define DEFAULT_FILE_CAPTURE_MAX_SIZE       1048576     // 1 MiB
 #define DEFAULT_FILE_CAPTURE_MIN_SIZE       0           // 0
 #define DEFAULT_FILE_CAPTURE_BLOCK_SIZE     32768       // 32 KiB
+#define DEFAULT_FILE_CAPTURE_QUEUE_SIZE     50          // 50 MiB
 class FileConfig
 {
 public:
@@ -53,6 +56,8 @@ public:
     int64_t file_capture_max_size = DEFAULT_FILE_CAPTURE_MAX_SIZE;
     int64_t file_capture_min_size = DEFAULT_FILE_CAPTURE_MIN_SIZE;
     int64_t file_capture_block_size = DEFAULT_FILE_CAPTURE_BLOCK_SIZE;
+    int64_t file_capture_queue_size = DEFAULT_FILE_CAPTURE_QUEUE_SIZE;
+    std::string file_capture_dir;
     int64_t file_depth =  0;
     static int64_t show_data_depth;
 
@@ -39,6 +39,7 @@
 #include "file_config.h"
 #include "hash/hashes.h"
 #include "util.h"
+#include "main/thread.h"
 #include "file_api/file_capture.h"
 
 // FIXIT-L these are no longer needed
@@ -47,6 +48,49 @@
 #define SHA256UPDATE  SHA256_Update
 #define SHA256FINAL   SHA256_Final
 
+// SHA256 contexts are recycled through a small per-thread free list instead
+// of being allocated for each file.  A file is only ever processed by the
+// packet thread that owns its flow so no locking is needed.  The context is
+// given back as soon as the signature is final.  The list is only open on
+// packet threads between file_lib_tinit() and file_lib_tterm(); contexts
+// released on any other thread go straight back to the heap.
+#define SHA256_POOL_MAX 16
+
+struct Sha256Pool
+{
+    void* free[SHA256_POOL_MAX];
+    unsigned count;
+    bool open;
+};
+
+static THREAD_LOCAL Sha256Pool sha256_pool;
+
+static inline void* sha256_context_get()
+{
+    if ( !sha256_pool.count )
+        return SnortAlloc(sizeof(SHA256CONTEXT));
+
+    // SnortAlloc zeroes and a middle piece may arrive without a start
+    void* ctx = sha256_pool.free[--sha256_pool.count];
+    memset(ctx, 0, sizeof(SHA256CONTEXT));
+    return ctx;
+}
+
+static inline void sha256_context_put(void* ctx)
+{
+    if ( sha256_pool.open && sha256_pool.count < SHA256_POOL_MAX )
+        sha256_pool.free[sha256_pool.count++] = ctx;
+    else
+        free(ctx);
+}
+
+static inline void sha256_final(FileContext* context, SHA256CONTEXT* ctx)
+{
+    context->sha256 = (uint8_t*)SnortAlloc(SHA256_HASH_SIZE);
+    SHA256FINAL(context->sha256, ctx);
+    context->file_state.sig_state = FILE_SIG_DONE;
+}
+
 static inline int get_data_size_from_depth_limit(FileContext* context, FileProcessType type, int
     data_size)
 {
@@ -144,38 +188,55 @@ void file_signature_sha256(
     switch (position)
     {
     case SNORT_FILE_START:
-        context->file_signature_context = SnortAlloc(sizeof(SHA256CONTEXT));
+        if (!context->file_signature_context)
+            context->file_signature_context = sha256_context_get();
         SHA256INIT((SHA256CONTEXT*)context->file_signature_context);
         SHA256UPDATE((SHA256CONTEXT*)context->file_signature_context, file_data, data_size);
         break;
     case SNORT_FILE_MIDDLE:
         if (!context->file_signature_context)
-            context->file_signature_context = SnortAlloc(sizeof(SHA256CONTEXT));
+            context->file_signature_context = sha256_context_get();
         SHA256UPDATE((SHA256CONTEXT*)context->file_signature_context, file_data, data_size);
         break;
     case SNORT_FILE_END:
         if (!context->file_signature_context)
-            context->file_signature_context = SnortAlloc(sizeof(SHA256CONTEXT));
+            context->file_signature_context = sha256_context_get();
         if (context->processed_bytes == 0)
             SHA256INIT((SHA256CONTEXT*)context->file_signature_context);
         SHA256UPDATE((SHA256CONTEXT*)context->file_signature_context, file_data, data_size);
-        context->sha256 = (uint8_t*)SnortAlloc(SHA256_HASH_SIZE);
-        SHA256FINAL(context->sha256, (SHA256CONTEXT*)context->file_signature_context);
-        context->file_state.sig_state = FILE_SIG_DONE;
+        sha256_final(context, (SHA256CONTEXT*)context->file_signature_context);
+        sha256_context_put(context->file_signature_context);
+        context->file_signature_context = NULL;
         break;
     case SNORT_FILE_FULL:
-        context->file_signature_context = SnortAlloc(sizeof (SHA256CONTEXT));
-        SHA256INIT((SHA256CONTEXT*)context->file_signature_context);
-        SHA256UPDATE((SHA256CONTEXT*)context->file_signature_context, file_data, data_size);
-        context->sha256 = (uint8_t*)SnortAlloc(SHA256_HASH_SIZE);
-        SHA256FINAL(context->sha256, (SHA256CONTEXT*)context->file_signature_context);
-        context->file_state.sig_state = FILE_SIG_DONE;
+        {
+            // the whole file is here so the context need not outlive this call
+            SHA256CONTEXT ctx;
+            SHA256INIT(&ctx);
+            SHA256UPDATE(&ctx, file_data, data_size);
+            sha256_final(context, &ctx);
+        }
         break;
     default:
         break;
     }
 }
 
+/*File library thread management*/
+
+void file_lib_tinit(void)
+{
+    sha256_pool.open = true;
+}
+
+void file_lib_tterm(void)
+{
+    while ( sha256_pool.count )
+        free(sha256_pool.free[--sha256_pool.count]);
+
+    sha256_pool.open = false;
+}
+
 /*File context management*/
 
 FileContext *file_context_create(void)
@@ -187,7 +248,7 @@ FileContext *file_context_create(void)
 static inline void cleanDynamicContext (FileContext *context)
 {
     if (context->file_signature_context)
-        free(context->file_signature_context);
+        sha256_context_put(context->file_signature_context);
     if(context->sha256)
         free(context->sha256);
     if(context->file_capture)
@@ -67,6 +67,10 @@ void file_type_id(FileContext* context, uint8_t* file_data, int data_size, FileP
 void file_signature_sha256(FileContext* context, uint8_t* file_data, int data_size, FilePosition
     position);
 
+/*File library thread management, called by each packet thread*/
+void file_lib_tinit(void);
+void file_lib_tterm(void);
+
 /*File context management*/
 FileContext* file_context_create(void);
 void file_context_reset(FileContext* context);
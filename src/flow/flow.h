@@ -256,6 +256,11 @@ public:  // FIXIT-M privatize if possible
     Inspector* ssn_server;
     long last_data_seen;
 
+    // owned by FlowWheel
+    Flow* wheel_prev, * wheel_next;
+    long wheel_time;
+    unsigned wheel_list;
+
     // everything from here down is zeroed
     FlowData* appDataList;
     Inspector* clouseau;  // service identifier
@@ -24,14 +24,24 @@
 #include "config.h"
 #endif
 
+#include <chrono>
+
 #include "packet_io/active.h"
 #include "packet_time.h"
 #include "ips_options/ips_flowbits.h"
-#include "hash/zhash.h"
 #include "main/snort_debug.h"
 
 #define SESSION_CACHE_FLAG_PURGING  0x01
 
+// wheel slots + flows moved per flow we are trying to prune
+#define WHEEL_WORK 4
+
+static inline uint64_t prune_clock()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 //-------------------------------------------------------------------------
 // FlowCache stuff
 //-------------------------------------------------------------------------
@@ -49,8 +59,7 @@ FlowCache::FlowCache (
     if ( !cleanup_flows )
         cleanup_flows = 1;
 
-    hash_table = new ZHash(config.max_sessions, sizeof(FlowKey));
-    hash_table->set_keyops(FlowKey::hash, FlowKey::compare);
+    hash_table = FlowTable::create(config);
 
     uni_head = new Flow;
     uni_tail = new Flow;
@@ -60,6 +69,9 @@ FlowCache::FlowCache (
 
     prunes = uni_count = 0;
     flags = 0x0;
+
+    for ( unsigned i = 0; i < PRUNE_LAT_BUCKETS; ++i )
+        prune_lat[i] = 0;
 }
 
 FlowCache::~FlowCache ()
@@ -79,6 +91,29 @@ void FlowCache::push(Flow* flow)
     flow->key = (FlowKey*)key;
 }
 
+void FlowCache::reset_prunes()
+{
+    prunes = 0;
+
+    for ( unsigned i = 0; i < PRUNE_LAT_BUCKETS; ++i )
+        prune_lat[i] = 0;
+}
+
+// only operations that pruned something are sampled
+void FlowCache::prune_done(uint64_t start, uint32_t pruned)
+{
+    if ( !pruned )
+        return;
+
+    uint64_t usecs = prune_clock() - start;
+    unsigned i = 0;
+
+    for ( uint64_t max = 1; i < PRUNE_LAT_BUCKETS - 1 and usecs >= max; max *= 10 )
+        ++i;
+
+    prune_lat[i]++;
+}
+
 int FlowCache::get_count()
 {
     return hash_table ? hash_table->get_count() : 0;
@@ -131,16 +166,24 @@ Flow* FlowCache::get(const FlowKey* key)
 
     if ( !flow )
     {
-        if ( !prune_stale(timestamp, nullptr) )
+        uint64_t start = prune_clock();
+        uint32_t pruned = prune_stale(timestamp, nullptr);
+
+        if ( !pruned )
         {
-            if ( !prune_unis() )
-                prune_excess(false, nullptr);
+            pruned = prune_unis();
+
+            if ( !pruned )
+                pruned = prune_excess(false, nullptr);
         }
         flow = (Flow*)hash_table->get(key);
 
         assert(flow);
         flow->reset();
         link_uni(flow);
+        wheel.add(flow, wheel_due(timestamp));
+
+        prune_done(start, pruned);
     }
     flow->last_data_seen = timestamp;
 
@@ -158,43 +201,61 @@ int FlowCache::remove(Flow* flow)
     if ( flow->next )
         unlink_uni(flow);
 
+    wheel.remove(flow);
     return hash_table->remove(flow->key);
 }
 
+// flows are checked as soon as either timeout could have passed
+time_t FlowCache::wheel_due(time_t last_data_seen)
+{
+    unsigned timeout = config.pruning_timeout;
+
+    if ( config.nominal_timeout < timeout )
+        timeout = config.nominal_timeout;
+
+    return last_data_seen + timeout + 1;
+}
+
+// flows that saw traffic since they were scheduled go back on the wheel
+bool FlowCache::reschedule(Flow* flow)
+{
+    time_t when = wheel_due(flow->last_data_seen);
+
+    if ( when <= flow->wheel_time )
+        return false;
+
+    wheel.add(flow, when);
+    return true;
+}
+
 uint32_t FlowCache::prune_stale(uint32_t thetime, Flow* save_me)
 {
-    Flow* flow;
     uint32_t pruned = 0;
     Active::suspend();
 
     /* Pruning, look for flows that have time'd out */
-    flow = (Flow*)hash_table->first();
+    const unsigned max_work = (cleanup_flows + 1) * WHEEL_WORK;
+    wheel.advance(thetime, max_work);
 
-    while ( flow )
-    {
-        // FIXIT-L this loops forever if 1 flow in cache
-        if (flow == save_me)
-        {
-            if ( hash_table->get_count() == 1 )
-                break;
+    Flow* flow = wheel.get_expired();
+    unsigned examined = 0;
 
-            hash_table->touch();
-        }
+    while ( flow and examined++ < max_work )
+    {
+        Flow* next = flow->wheel_next;
 
-        else if ((flow->last_data_seen + config.pruning_timeout) < thetime)
+        if ( flow != save_me and !reschedule(flow) and
+            (flow->last_data_seen + config.pruning_timeout) < thetime )
         {
             DEBUG_WRAP(DebugMessage(DEBUG_STREAM, "pruning stale flow\n"); );
             flow->ssn_state.session_flags |= SSNFLAG_TIMEDOUT;
             release(flow, "stale/timeout");
             pruned++;
-        }
-        else
-            break;
-
-        if (pruned > cleanup_flows)
-            break;
 
-        flow = (Flow*)hash_table->first();
+            if (pruned > cleanup_flows)
+                break;
+        }
+        flow = next;
     }
 
     prunes += pruned;
@@ -277,30 +338,57 @@ uint32_t FlowCache::prune_excess(bool memCheck, Flow* save_me)
     return pruned;
 }
 
+void FlowCache::prune_memcap(uint32_t thetime, Flow* save_me)
+{
+    uint64_t start = prune_clock();
+
+    // smack the older timed out flows
+    uint32_t pruned = prune_stale(thetime, save_me);
+
+    // if no luck, try the memcap
+    if ( !pruned )
+        pruned = prune_excess(true, save_me);
+
+    prune_done(start, pruned);
+}
+
 void FlowCache::timeout(uint32_t flowCount, time_t cur_time)
 {
+    Flow* flow = wheel.get_expired();
+
+    // nothing to do until the wheel ticks or the oldest flow times out
+    if ( !wheel.behind(cur_time) and
+        (!flow or ((time_t)(flow->last_data_seen + config.nominal_timeout) > cur_time and
+        wheel_due(flow->last_data_seen) <= flow->wheel_time)) )
+        return;
+
+    uint64_t start = prune_clock();
     uint32_t flowRetiredCount = 0, flowExaminedCount = 0;
     uint32_t flowMax = flowCount * 2;
 
-    Flow* flow = (Flow*)hash_table->current();
-
-    if ( !flow )
-        flow = (Flow*)hash_table->first();
+    wheel.advance(cur_time, flowCount * WHEEL_WORK);
+    flow = wheel.get_expired();
 
     while ( flow && flowRetiredCount < flowCount && flowExaminedCount < flowMax )
     {
-        if ((time_t)(flow->last_data_seen + config.nominal_timeout) > cur_time)
-            break;
-
+        Flow* next = flow->wheel_next;
         flowExaminedCount++;
 
-        DEBUG_WRAP(DebugMessage(DEBUG_STREAM, "retiring stale flow\n"); );
-        flow->ssn_state.session_flags |= SSNFLAG_TIMEDOUT;
-        release(flow, "stale/timeout");
+        if ( !reschedule(flow) )
+        {
+            // the expired list is ordered by last_data_seen
+            if ((time_t)(flow->last_data_seen + config.nominal_timeout) > cur_time)
+                break;
 
-        flowRetiredCount++;
-        flow = (Flow*)hash_table->current();
+            DEBUG_WRAP(DebugMessage(DEBUG_STREAM, "retiring stale flow\n"); );
+            flow->ssn_state.session_flags |= SSNFLAG_TIMEDOUT;
+            release(flow, "stale/timeout");
+
+            flowRetiredCount++;
+        }
+        flow = next;
     }
+    prune_done(start, flowRetiredCount);
 }
 
 /* Remove all flows from the hash table. */
@@ -23,12 +23,20 @@
 #define FLOW_CACHE_H
 
 // there is a FlowCache instance for each protocol.
-// Flows are stored in a ZHash instance by FlowKey.
+// Flows are stored in a FlowTable instance by FlowKey.
+// Timeouts are driven by a FlowWheel so that pruning does a bounded amount
+// of work per packet regardless of the number of flows.
 
 #include "flow/flow_config.h"
 #include "flow/flow_key.h"
+#include "flow/flow_table.h"
+#include "flow/flow_wheel.h"
 #include "flow/memcap.h"
 #include "stream/stream.h"
+#include "framework/counts.h"
+
+// prune latency histogram: < 1us, < 10us, < 100us, < 1ms, >= 1ms
+#define PRUNE_LAT_BUCKETS 5
 
 class FlowCache
 {
@@ -50,6 +58,7 @@ public:
     uint32_t prune_unis();
     uint32_t prune_stale(uint32_t thetime, Flow* save_me);
     uint32_t prune_excess(bool memCheck, Flow* save_me);
+    void prune_memcap(uint32_t thetime, Flow* save_me);
     void timeout(uint32_t flowCount, time_t cur_time);
 
     int purge();
@@ -57,7 +66,8 @@ public:
 
     uint32_t get_max_flows() { return config.max_sessions; }
     uint32_t get_prunes() { return prunes; }
-    void reset_prunes() { prunes = 0; }
+    PegCount get_prune_latency(unsigned i) { return prune_lat[i]; }
+    void reset_prunes();
 
     void unlink_uni(Flow*);
 
@@ -67,6 +77,10 @@ private:
     void link_uni(Flow*);
     int remove(Flow*);
 
+    time_t wheel_due(time_t last_data_seen);
+    bool reschedule(Flow*);
+    void prune_done(uint64_t start, uint32_t pruned);
+
 private:
     const FlowConfig& config;
     uint32_t cleanup_flows;
@@ -75,8 +89,10 @@ private:
     uint32_t flags;
 
     Memcap memcap;
+    FlowWheel wheel;
+    PegCount prune_lat[PRUNE_LAT_BUCKETS];
 
-    class ZHash* hash_table;
+    FlowTable* hash_table;
     Flow* uni_head, * uni_tail;
 };
 
@@ -23,12 +23,19 @@
 
 // configured by the stream module for each cache instance
 
+enum class FlowTableType
+{
+    CHAINED,
+    OPEN
+};
+
 struct FlowConfig
 {
     unsigned max_sessions = 0;
     unsigned long mem_cap = 0;
     unsigned pruning_timeout = 0;
     unsigned nominal_timeout = 0;
+    FlowTableType table_type = FlowTableType::CHAINED;
 };
 
 #endif
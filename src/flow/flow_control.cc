@@ -105,6 +105,25 @@ PegCount FlowControl::get_prunes (PktType proto)
     return cache ? cache->get_prunes() : 0;
 }
 
+PegCount FlowControl::get_prune_latency(unsigned bucket)
+{
+    const PktType protos[] =
+    {
+        PktType::IP, PktType::ICMP, PktType::TCP,
+        PktType::UDP, PktType::PDU, PktType::FILE
+    };
+    PegCount sum = 0;
+
+    for ( auto proto : protos )
+    {
+        FlowCache* cache = get_cache(proto);
+
+        if ( cache )
+            sum += cache->get_prune_latency(bucket);
+    }
+    return sum;
+}
+
 PegCount FlowControl::get_flows(PktType proto)
 {
     switch ( proto )
@@ -230,12 +249,7 @@ void FlowControl::prune_flows (PktType proto, Packet* p)
     if ( !cache )
         return;
 
-    // smack the older timed out flows
-    if (!cache->prune_stale(p->pkth->ts.tv_sec, (Flow*)p->flow))
-    {
-        // if no luck, try the memcap
-        cache->prune_excess(true, (Flow*)p->flow);
-    }
+    cache->prune_memcap(p->pkth->ts.tv_sec, (Flow*)p->flow);
 }
 
 void FlowControl::timeout_flows(uint32_t flowCount, time_t cur_time)
@@ -76,6 +76,7 @@ public:
     uint32_t max_flows(PktType);
 
     PegCount get_prunes(PktType);
+    PegCount get_prune_latency(unsigned bucket);
     PegCount get_flows(PktType);
     void clear_counts();
 
@@ -0,0 +1,411 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flow_table.cc
+
+#include "flow/flow_table.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "flow/flow_key.h"
+#include "utils/util.h"
+
+//-------------------------------------------------------------------------
+// FlowTable stuff
+//-------------------------------------------------------------------------
+
+FlowTable* FlowTable::create(const FlowConfig& fc)
+{
+    if ( fc.table_type == FlowTableType::OPEN )
+        return new OpenFlowTable(fc.max_sessions);
+
+    return new ChainedFlowTable(fc.max_sessions);
+}
+
+ChainedFlowTable::ChainedFlowTable(unsigned rows)
+{
+    hash = new ZHash(rows, sizeof(FlowKey));
+    hash->set_keyops(FlowKey::hash, FlowKey::compare);
+}
+
+ChainedFlowTable::~ChainedFlowTable()
+{
+    delete hash;
+}
+
+//-------------------------------------------------------------------------
+// OpenFlowTable private stuff
+//-------------------------------------------------------------------------
+
+#define BUCKET_SLOTS 8
+#define NO_NODE 0xFFFFFFFF
+
+// keys are compared as 48 bytes; without address space ids the last 4
+// bytes are not part of the key (see FlowKey::compare())
+static_assert(sizeof(FlowKey) == 48, "FlowKey size changed; update key_equal()");
+
+#ifdef HAVE_DAQ_ADDRESS_SPACE_ID
+#define KEY_TAIL_MASK 0xFFFF
+#else
+#define KEY_TAIL_MASK 0x0FFF
+#endif
+
+struct OpenFlowNode
+{
+    FlowKey key;
+    void* data;
+    uint32_t gprev, gnext;  // lru or free list
+    uint32_t hash;
+};
+
+// one cache line; a tag of 0 is an empty slot.  overflow counts entries
+// whose home bucket is at or before this one but are stored after it so
+// lookups can stop at the first bucket with no overflow.
+struct alignas(64) OpenFlowBucket
+{
+    uint16_t tag[BUCKET_SLOTS];
+    uint32_t node[BUCKET_SLOTS];
+    uint32_t overflow;
+};
+
+static inline uint32_t get_hash(const void* key)
+{
+    return FlowKey::hash(nullptr, (unsigned char*)key, sizeof(FlowKey));
+}
+
+// the bucket index comes from the low bits so take the tag from the high
+// bits of a remix
+static inline uint16_t get_tag(uint32_t hash)
+{
+    uint16_t tag = (hash * 0x9E3779B1) >> 16;
+    return tag ? tag : 1;
+}
+
+// returns a mask with bit 2*i set for each matching slot i
+static inline unsigned match_tags(const OpenFlowBucket& b, uint16_t tag)
+{
+#if defined(__SSE2__)
+    __m128i t = _mm_set1_epi16(tag);
+    __m128i v = _mm_load_si128((const __m128i*)b.tag);
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(t, v)) & 0x5555;
+#else
+    unsigned m = 0;
+
+    for ( unsigned i = 0; i < BUCKET_SLOTS; ++i )
+        if ( b.tag[i] == tag )
+            m |= 1 << (2*i);
+
+    return m;
+#endif
+}
+
+static inline bool key_equal(const void* s1, const void* s2)
+{
+#if defined(__AVX2__)
+    __m256i a = _mm256_loadu_si256((const __m256i*)s1);
+    __m256i b = _mm256_loadu_si256((const __m256i*)s2);
+    __m128i c = _mm_loadu_si128((const __m128i*)s1 + 2);
+    __m128i d = _mm_loadu_si128((const __m128i*)s2 + 2);
+
+    return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) == 0xFFFFFFFF and
+        (_mm_movemask_epi8(_mm_cmpeq_epi8(c, d)) & KEY_TAIL_MASK) == KEY_TAIL_MASK;
+
+#elif defined(__SSE2__)
+    const __m128i* a = (const __m128i*)s1;
+    const __m128i* b = (const __m128i*)s2;
+
+    __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128(a), _mm_loadu_si128(b));
+    __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128(a + 1), _mm_loadu_si128(b + 1));
+    __m128i tl = _mm_cmpeq_epi8(_mm_loadu_si128(a + 2), _mm_loadu_si128(b + 2));
+
+    return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xFFFF and
+        (_mm_movemask_epi8(tl) & KEY_TAIL_MASK) == KEY_TAIL_MASK;
+
+#else
+    return !FlowKey::compare(s1, s2, sizeof(FlowKey));
+#endif
+}
+
+void OpenFlowTable::glink_node(uint32_t n)
+{
+    nodes[n].gprev = NO_NODE;
+    nodes[n].gnext = ghead;
+
+    if ( ghead != NO_NODE )
+        nodes[ghead].gprev = n;
+    else
+        gtail = n;
+
+    ghead = n;
+}
+
+void OpenFlowTable::gunlink_node(uint32_t n)
+{
+    OpenFlowNode& node = nodes[n];
+
+    if ( cursor == n )
+        cursor = node.gprev;
+
+    if ( node.gprev != NO_NODE )
+        nodes[node.gprev].gnext = node.gnext;
+    else
+        ghead = node.gnext;
+
+    if ( node.gnext != NO_NODE )
+        nodes[node.gnext].gprev = node.gprev;
+    else
+        gtail = node.gprev;
+}
+
+uint32_t OpenFlowTable::find_node(const void* key, uint32_t hash)
+{
+    uint16_t tag = get_tag(hash);
+    uint32_t b = hash & mask;
+
+    while ( true )
+    {
+        const OpenFlowBucket& bucket = buckets[b];
+        unsigned m = match_tags(bucket, tag);
+
+        while ( m )
+        {
+            unsigned i = __builtin_ctz(m) >> 1;
+            uint32_t n = bucket.node[i];
+
+            if ( nodes[n].hash == hash and key_equal(&nodes[n].key, key) )
+                return n;
+
+            m &= m - 1;
+        }
+
+        if ( !bucket.overflow )
+            return NO_NODE;
+
+        b = (b + 1) & mask;
+    }
+}
+
+void OpenFlowTable::insert_node(uint32_t n, uint32_t hash)
+{
+    uint32_t b = hash & mask;
+
+    while ( true )
+    {
+        OpenFlowBucket& bucket = buckets[b];
+
+        for ( unsigned i = 0; i < BUCKET_SLOTS; ++i )
+        {
+            if ( !bucket.tag[i] )
+            {
+                bucket.tag[i] = get_tag(hash);
+                bucket.node[i] = n;
+                return;
+            }
+        }
+        bucket.overflow++;
+        b = (b + 1) & mask;
+    }
+}
+
+void OpenFlowTable::delete_node(uint32_t n, uint32_t hash)
+{
+    uint32_t b = hash & mask;
+
+    while ( true )
+    {
+        OpenFlowBucket& bucket = buckets[b];
+
+        for ( unsigned i = 0; i < BUCKET_SLOTS; ++i )
+        {
+            if ( bucket.tag[i] and bucket.node[i] == n )
+            {
+                bucket.tag[i] = 0;
+                return;
+            }
+        }
+        assert(bucket.overflow);
+        bucket.overflow--;
+        b = (b + 1) & mask;
+    }
+}
+
+//-------------------------------------------------------------------------
+// OpenFlowTable public stuff
+//-------------------------------------------------------------------------
+
+OpenFlowTable::OpenFlowTable(unsigned max)
+{
+    // size for a load factor of at most 75%
+    uint32_t rows = 1;
+
+    while ( rows * (BUCKET_SLOTS * 3 / 4) < max )
+        rows <<= 1;
+
+    void* pv = nullptr;
+
+    if ( posix_memalign(&pv, sizeof(OpenFlowBucket), rows * sizeof(OpenFlowBucket)) )
+        FatalError("can't allocate flow table\n");
+
+    buckets = (OpenFlowBucket*)pv;
+    memset(buckets, 0, rows * sizeof(OpenFlowBucket));
+
+    nodes = (OpenFlowNode*)SnortAlloc(max * sizeof(OpenFlowNode));
+
+    mask = rows - 1;
+    max_nodes = max;
+    num_nodes = 0;
+    count = 0;
+
+    ghead = gtail = NO_NODE;
+    fhead = cursor = NO_NODE;
+}
+
+OpenFlowTable::~OpenFlowTable()
+{
+    free(buckets);
+    free(nodes);
+}
+
+// nodes can't be added after the table is in use because keys must not
+// move; FlowCache pushes exactly max_sessions flows at startup
+void* OpenFlowTable::push(void* p)
+{
+    if ( num_nodes == max_nodes )
+        FatalError("flow table is full (%u)\n", max_nodes);
+
+    uint32_t n = num_nodes++;
+
+    nodes[n].data = p;
+    nodes[n].gprev = NO_NODE;
+    nodes[n].gnext = fhead;
+    fhead = n;
+
+    return &nodes[n].key;
+}
+
+void* OpenFlowTable::pop()
+{
+    if ( fhead == NO_NODE )
+        return nullptr;
+
+    uint32_t n = fhead;
+    fhead = nodes[n].gnext;
+
+    return nodes[n].data;
+}
+
+void* OpenFlowTable::first()
+{
+    cursor = gtail;
+    return cursor != NO_NODE ? nodes[cursor].data : nullptr;
+}
+
+bool OpenFlowTable::touch()
+{
+    uint32_t n = cursor;
+
+    if ( n == NO_NODE )
+        return false;
+
+    cursor = nodes[n].gprev;
+
+    if ( n != ghead )
+    {
+        gunlink_node(n);
+        glink_node(n);
+        return true;
+    }
+    return false;
+}
+
+void* OpenFlowTable::find(const void* key)
+{
+    uint32_t n = find_node(key, get_hash(key));
+
+    if ( n == NO_NODE )
+        return nullptr;
+
+    if ( n != ghead )
+    {
+        gunlink_node(n);
+        glink_node(n);
+    }
+    return nodes[n].data;
+}
+
+void* OpenFlowTable::get(const void* key)
+{
+    uint32_t hash = get_hash(key);
+    uint32_t n = find_node(key, hash);
+
+    if ( n != NO_NODE )
+    {
+        if ( n != ghead )
+        {
+            gunlink_node(n);
+            glink_node(n);
+        }
+        return nodes[n].data;
+    }
+
+    if ( fhead == NO_NODE )
+        return nullptr;
+
+    n = fhead;
+    fhead = nodes[n].gnext;
+
+    memcpy(&nodes[n].key, key, sizeof(FlowKey));
+    nodes[n].hash = hash;
+
+    insert_node(n, hash);
+    glink_node(n);
+    count++;
+
+    return nodes[n].data;
+}
+
+bool OpenFlowTable::remove(const void* key)
+{
+    uint32_t hash = get_hash(key);
+    uint32_t n = find_node(key, hash);
+
+    if ( n == NO_NODE )
+        return false;
+
+    delete_node(n, hash);
+    gunlink_node(n);
+
+    nodes[n].gprev = NO_NODE;
+    nodes[n].gnext = fhead;
+    fhead = n;
+
+    count--;
+    return true;
+}
+
@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flow_table.h
+
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+// FlowTable is the storage used by FlowCache to map FlowKeys to Flows.
+// the interface follows ZHash: nodes are pushed up front with their data,
+// get() takes a free node for a new key, and an LRU list is maintained for
+// pruning via first() / touch().  the key returned by push() is stable for
+// the life of the table.
+//
+// ChainedFlowTable is ZHash.  OpenFlowTable uses open addressing with 8
+// entries per 64 byte bucket; each entry has a 16 bit fingerprint which is
+// checked 8 at a time before any key is touched and keys are compared with
+// SSE2 / AVX2 when available.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flow/flow_config.h"
+#include "hash/zhash.h"
+
+class FlowTable
+{
+public:
+    virtual ~FlowTable() { }
+
+    virtual void* push(void*) = 0;
+    virtual void* pop() = 0;
+
+    virtual void* first() = 0;
+    virtual bool touch() = 0;
+
+    virtual void* find(const void* key) = 0;
+    virtual void* get(const void* key) = 0;
+    virtual bool remove(const void* key) = 0;
+
+    virtual unsigned get_count() = 0;
+
+    static FlowTable* create(const FlowConfig&);
+};
+
+class ChainedFlowTable : public FlowTable
+{
+public:
+    ChainedFlowTable(unsigned rows);
+    ~ChainedFlowTable();
+
+    void* push(void* p) override
+    { return hash->push(p); }
+
+    void* pop() override
+    { return hash->pop(); }
+
+    void* first() override
+    { return hash->first(); }
+
+    bool touch() override
+    { return hash->touch(); }
+
+    void* find(const void* key) override
+    { return hash->find(key); }
+
+    void* get(const void* key) override
+    { return hash->get(key); }
+
+    bool remove(const void* key) override
+    { return hash->remove(key); }
+
+    unsigned get_count() override
+    { return hash->get_count(); }
+
+private:
+    ZHash* hash;
+};
+
+struct OpenFlowNode;
+struct OpenFlowBucket;
+
+class OpenFlowTable : public FlowTable
+{
+public:
+    OpenFlowTable(unsigned max_nodes);
+    ~OpenFlowTable();
+
+    void* push(void*) override;
+    void* pop() override;
+
+    void* first() override;
+    bool touch() override;
+
+    void* find(const void* key) override;
+    void* get(const void* key) override;
+    bool remove(const void* key) override;
+
+    unsigned get_count() override
+    { return count; }
+
+private:
+    uint32_t find_node(const void* key, uint32_t hash);
+    void insert_node(uint32_t node, uint32_t hash);
+    void delete_node(uint32_t node, uint32_t hash);
+
+    void glink_node(uint32_t);
+    void gunlink_node(uint32_t);
+
+private:
+    OpenFlowBucket* buckets;
+    OpenFlowNode* nodes;
+
+    uint32_t mask;
+    uint32_t max_nodes;
+    uint32_t num_nodes;
+    unsigned count;
+
+    uint32_t ghead, gtail;
+    uint32_t fhead;
+    uint32_t cursor;
+};
+
+#endif
+
@@ -0,0 +1,192 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flow_wheel.cc
+
+#include "flow/flow_wheel.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <assert.h>
+
+#include "flow/flow.h"
+
+//-------------------------------------------------------------------------
+// FlowWheel stuff
+//-------------------------------------------------------------------------
+
+FlowWheel::FlowWheel()
+{
+    for ( unsigned i = 0; i < WHEEL_LISTS; ++i )
+        head[i] = nullptr;
+
+    exp_tail = nullptr;
+    cursor = 0;
+    cascading = false;
+    l0_count = l1_count = exp_count = 0;
+}
+
+unsigned FlowWheel::get_list(time_t when)
+{
+    // late adds are checked on the next tick
+    if ( when < cursor )
+        when = cursor;
+
+    if ( when - cursor < WHEEL_L0_SLOTS )
+        return when & WHEEL_L0_MASK;
+
+    time_t blocks = (when >> WHEEL_L0_BITS) - (cursor >> WHEEL_L0_BITS);
+
+    if ( blocks >= WHEEL_L1_SLOTS )
+        blocks = WHEEL_L1_SLOTS - 1;
+
+    return WHEEL_L0_SLOTS + (((cursor >> WHEEL_L0_BITS) + blocks) & WHEEL_L1_MASK);
+}
+
+// slots are lifo; the expired list is fifo to keep it in time order
+void FlowWheel::link(Flow* flow, unsigned list)
+{
+    flow->wheel_list = list + 1;
+
+    if ( list == WHEEL_EXPIRED )
+    {
+        flow->wheel_next = nullptr;
+        flow->wheel_prev = exp_tail;
+
+        if ( exp_tail )
+            exp_tail->wheel_next = flow;
+        else
+            head[list] = flow;
+
+        exp_tail = flow;
+        ++exp_count;
+        return;
+    }
+
+    flow->wheel_prev = nullptr;
+    flow->wheel_next = head[list];
+
+    if ( head[list] )
+        head[list]->wheel_prev = flow;
+
+    head[list] = flow;
+
+    if ( list < WHEEL_L0_SLOTS )
+        ++l0_count;
+    else
+        ++l1_count;
+}
+
+void FlowWheel::unlink(Flow* flow)
+{
+    assert(flow->wheel_list);
+    unsigned list = flow->wheel_list - 1;
+
+    if ( flow->wheel_prev )
+        flow->wheel_prev->wheel_next = flow->wheel_next;
+    else
+        head[list] = flow->wheel_next;
+
+    if ( flow->wheel_next )
+        flow->wheel_next->wheel_prev = flow->wheel_prev;
+
+    else if ( list == WHEEL_EXPIRED )
+        exp_tail = flow->wheel_prev;
+
+    if ( list == WHEEL_EXPIRED )
+        --exp_count;
+    else if ( list < WHEEL_L0_SLOTS )
+        --l0_count;
+    else
+        --l1_count;
+
+    flow->wheel_prev = flow->wheel_next = nullptr;
+    flow->wheel_list = 0;
+}
+
+void FlowWheel::add(Flow* flow, time_t when)
+{
+    if ( flow->wheel_list )
+        unlink(flow);
+
+    if ( !cursor )
+        cursor = when;
+
+    flow->wheel_time = when;
+    link(flow, get_list(when));
+}
+
+void FlowWheel::remove(Flow* flow)
+{
+    if ( flow->wheel_list )
+        unlink(flow);
+}
+
+void FlowWheel::advance(time_t now, unsigned max)
+{
+    unsigned work = 0;
+
+    while ( cursor and cursor <= now and work < max )
+    {
+        if ( cascading )
+        {
+            unsigned l1 = WHEEL_L0_SLOTS + ((cursor >> WHEEL_L0_BITS) & WHEEL_L1_MASK);
+
+            while ( Flow* flow = head[l1] )
+            {
+                if ( work++ >= max )
+                    return;
+
+                unlink(flow);
+                link(flow, get_list(flow->wheel_time));
+            }
+            cascading = false;
+        }
+
+        unsigned l0 = cursor & WHEEL_L0_MASK;
+
+        while ( Flow* flow = head[l0] )
+        {
+            if ( work++ >= max )
+                return;
+
+            unlink(flow);
+            link(flow, WHEEL_EXPIRED);
+        }
+        ++work;
+
+        // skip empty time but never get ahead of now or add() would
+        // schedule into slots that were already passed
+        time_t next = l0_count ? cursor + 1 : (cursor | WHEEL_L0_MASK) + 1;
+
+        if ( !l0_count and !l1_count )
+            next = now + 1;
+
+        else if ( next > now + 1 )
+            next = now + 1;
+
+        if ( (next >> WHEEL_L0_BITS) != (cursor >> WHEEL_L0_BITS) )
+        {
+            unsigned l1 = WHEEL_L0_SLOTS + ((next >> WHEEL_L0_BITS) & WHEEL_L1_MASK);
+            cascading = (head[l1] != nullptr);
+        }
+        cursor = next;
+    }
+}
+
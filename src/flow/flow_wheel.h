@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flow_wheel.h
+
+#ifndef FLOW_WHEEL_H
+#define FLOW_WHEEL_H
+
+// FlowWheel is a two level timing wheel with 1 second resolution used by
+// FlowCache to find flows that may have timed out without scanning the
+// cache.  level 0 has a slot for each of the next 256 seconds and level 1
+// has a slot for each of the following 64 blocks of 256 seconds (~4.5
+// hours).  anything further out is parked in the last level 1 slot and
+// rescheduled when that slot is cascaded.
+//
+// flows are scheduled once when created and are not moved when they see
+// traffic.  when a slot comes due its flows are moved to the expired list
+// in order of scheduled time and the owner checks last_data_seen to either
+// release the flow or schedule it again.  the expired list is therefore
+// ordered by last_data_seen for flows that have not been refreshed.
+
+#include <time.h>
+
+class Flow;
+
+#define WHEEL_L0_BITS 8
+#define WHEEL_L0_SLOTS (1 << WHEEL_L0_BITS)
+#define WHEEL_L0_MASK (WHEEL_L0_SLOTS - 1)
+#define WHEEL_L1_SLOTS 64
+#define WHEEL_L1_MASK (WHEEL_L1_SLOTS - 1)
+
+#define WHEEL_EXPIRED (WHEEL_L0_SLOTS + WHEEL_L1_SLOTS)
+#define WHEEL_LISTS (WHEEL_EXPIRED + 1)
+
+class FlowWheel
+{
+public:
+    FlowWheel();
+
+    // check the flow at or after the given time
+    void add(Flow*, time_t when);
+    void remove(Flow*);
+
+    // move flows due by now to the expired list; work is bounded by max
+    // (slots + flows moved) and the wheel picks up where it left off on
+    // the next call.
+    void advance(time_t now, unsigned max);
+
+    bool behind(time_t now)
+    { return cursor and cursor <= now; }
+
+    Flow* get_expired()
+    { return head[WHEEL_EXPIRED]; }
+
+    unsigned get_count()
+    { return l0_count + l1_count + exp_count; }
+
+private:
+    unsigned get_list(time_t when);
+    void link(Flow*, unsigned list);
+    void unlink(Flow*);
+
+private:
+    Flow* head[WHEEL_LISTS];
+    Flow* exp_tail;
+
+    time_t cursor;  // next second to process; 0 until first add
+    bool cascading; // level 1 slot for cursor not yet moved to level 0
+
+    unsigned l0_count;
+    unsigned l1_count;
+    unsigned exp_count;
+};
+
+#endif
+
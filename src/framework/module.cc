@@ -59,7 +59,12 @@ void Module::sum_stats()
 
     for ( int i = 0; i < num_counts; i++ )
     {
-        counts[i] += p[i];
+        if ( !is_max_peg(i) )
+            counts[i] += p[i];
+
+        else if ( p[i] > counts[i] )
+            counts[i] = p[i];
+
         p[i] = 0;
     }
 }
@@ -134,6 +134,11 @@ public:
     virtual const char* get_defaults() const
     { return nullptr; }
 
+    // pegs that record a per thread maximum are combined across threads
+    // with max instead of being added up
+    virtual bool is_max_peg(unsigned /*index*/) const
+    { return false; }
+
     virtual void sum_stats();
     virtual void show_stats();
     virtual void reset_stats();
@@ -69,6 +69,60 @@ int Mpse::search_all(
     return _search(T, n, match, data, current_state);
 }
 
+int Mpse::search_batch(MpseBatchItem* items, unsigned num, MpseMatch match)
+{
+    PROFILE_VARS;
+    MODULE_PROFILE_START(mpsePerfStats);
+
+    int ret = _search_batch(items, num, match);
+
+    if ( inc_global_counter )
+    {
+        for ( unsigned i = 0; i < num; ++i )
+            s_bcnt += items[i].len;
+    }
+
+    MODULE_PROFILE_END(mpsePerfStats);
+    return ret;
+}
+
+// the default can't tell from _search() whether the match function
+// stopped it so the match is wrapped
+struct BatchMatch
+{
+    MpseMatch match;
+    void* data;
+    bool stopped;
+};
+
+static int batch_match(void* id, void* tree, int index, void* data, void* neg_list)
+{
+    BatchMatch* bm = (BatchMatch*)data;
+    int ret = bm->match(id, tree, index, bm->data, neg_list);
+
+    if ( ret > 0 )
+        bm->stopped = true;
+
+    return ret;
+}
+
+int Mpse::_search_batch(MpseBatchItem* items, unsigned num, MpseMatch match)
+{
+    int nfound = 0;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        MpseBatchItem& item = items[i];
+        BatchMatch bm = { match, item.data, false };
+        int state = 0;
+
+        item.nfound = _search(item.buf, item.len, batch_match, &bm, &state);
+        item.stopped = bm.stopped;
+        nfound += item.nfound;
+    }
+    return nfound;
+}
+
 uint64_t Mpse::get_pattern_byte_count()
 {
     return s_bcnt;
@@ -53,6 +53,19 @@ typedef int (* MpseBuild)(SnortConfig*, void* id, void** existing_tree);
 typedef int (* MpseNegate)(void* id, void** list);
 typedef int (* MpseMatch)(void* id, void* tree, int index, void* data, void* neg_list);
 
+// one buffer for search_batch(); each buffer is searched from the start
+// state and its matches are passed to the match function with its data.
+struct MpseBatchItem
+{
+    const unsigned char* buf;
+    int len;
+    void* data;
+
+    // set by search_batch()
+    int nfound;
+    bool stopped;  // match returned > 0
+};
+
 class SO_PUBLIC Mpse
 {
 public:
@@ -66,6 +79,8 @@ public:
         SnortConfig* sc, const uint8_t* pat, unsigned len,
         bool noCase, bool negate, void* ID, int IID) = 0;
 
+    // the fast pattern groups are compiled by a pool of threads so this
+    // may be called for different instances concurrently
     virtual int prep_patterns(
     SnortConfig*, MpseBuild, MpseNegate) = 0;
 
@@ -77,6 +92,12 @@ public:
     const unsigned char* T, int n, MpseMatch,
     void* data, int* current_state);
 
+    // search several buffers in one call.  engines may interleave the
+    // walks and defer matches until the walks are done; matches for each
+    // buffer are still delivered in order and a match return > 0 stops
+    // that buffer only.  returns the total number of matches.
+    int search_batch(MpseBatchItem*, unsigned num, MpseMatch);
+
     virtual void set_opt(int) { }
     virtual int print_info() { return 0; }
     virtual int get_pattern_count() { return 0; }
@@ -94,6 +115,9 @@ protected:
     const unsigned char* T, int n, MpseMatch,
     void* data, int* current_state) = 0;
 
+    // the default searches each buffer in turn
+    virtual int _search_batch(MpseBatchItem*, unsigned num, MpseMatch);
+
 private:
     std::string method;
     bool inc_global_counter;
@@ -516,6 +516,91 @@ void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+/*** SHA-256 WITH THE X86 SHA EXTENSIONS ******************************/
+/*
+ * When the CPU has the SHA extensions the block transform is done with
+ * sha256rnds2/sha256msg1/sha256msg2, several blocks per call so the
+ * state stays in registers between them.  Support is checked once at
+ * load time; otherwise the portable transform above is used.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA2_X86
+#include <cpuid.h>
+#include <immintrin.h>
+
+static int sha256_use_ni = 0;
+
+__attribute__((constructor))
+static void SHA256_Detect(void) {
+	unsigned int	a, b, c, d;
+
+	if (__get_cpuid_max(0, 0) < 7)
+		return;
+
+	__cpuid(1, a, b, c, d);
+	if (!(c & bit_SSE4_1))
+		return;
+
+	__cpuid_count(7, 0, a, b, c, d);
+	sha256_use_ni = (b & (1 << 29)) != 0;
+}
+
+__attribute__((target("sha,sse4.1")))
+static void SHA256_Transform_NI(sha2_word32* state, const sha2_byte* data, size_t blocks) {
+	const __m128i	mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i		abef, cdgh, abef_save, cdgh_save, msg, tmp, W[4];
+	int		j;
+
+	/* The instructions want the state as ABEF and CDGH */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1);
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B);
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);
+
+	while (blocks--) {
+		abef_save = abef;
+		cdgh_save = cdgh;
+
+		/* 4 rounds at a time; W[] holds the last 16 schedule words */
+		for (j = 0; j < 16; j++) {
+			if (j < 4) {
+				W[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * j)), mask);
+			} else {
+				tmp = _mm_sha256msg1_epu32(W[j & 3], W[(j + 1) & 3]);
+				tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(W[(j + 3) & 3], W[(j + 2) & 3], 4));
+				W[j & 3] = _mm_sha256msg2_epu32(tmp, W[(j + 3) & 3]);
+			}
+			msg = _mm_add_epi32(W[j & 3], _mm_loadu_si128((const __m128i*)&K256[4 * j]));
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0E));
+		}
+
+		abef = _mm_add_epi32(abef, abef_save);
+		cdgh = _mm_add_epi32(cdgh, cdgh_save);
+		data += SHA256_BLOCK_LENGTH;
+	}
+
+	/* And back to ABCD and EFGH */
+	tmp = _mm_shuffle_epi32(abef, 0x1B);
+	cdgh = _mm_shuffle_epi32(cdgh, 0xB1);
+	_mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(tmp, cdgh, 0xF0));
+	_mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+#endif /* x86 */
+
+static void SHA256_Blocks(SHA256_CTX* context, const sha2_byte* data, size_t blocks) {
+#ifdef SHA2_X86
+	if (sha256_use_ni) {
+		SHA256_Transform_NI(context->state, data, blocks);
+		return;
+	}
+#endif
+	while (blocks--) {
+		SHA256_Transform(context, (const sha2_word32*)data);
+		data += SHA256_BLOCK_LENGTH;
+	}
+}
+
 void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -538,7 +623,7 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			context->bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA256_Transform(context, (sha2_word32*)context->buffer);
+			SHA256_Blocks(context, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->buffer[usedspace], data, len);
@@ -548,12 +633,14 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= SHA256_BLOCK_LENGTH) {
+	if (len >= SHA256_BLOCK_LENGTH) {
 		/* Process as many complete blocks as we can */
-		SHA256_Transform(context, (sha2_word32*)data);
-		context->bitcount += SHA256_BLOCK_LENGTH << 3;
-		len -= SHA256_BLOCK_LENGTH;
-		data += SHA256_BLOCK_LENGTH;
+		size_t	blocks = len / SHA256_BLOCK_LENGTH;
+
+		SHA256_Blocks(context, data, blocks);
+		context->bitcount += (sha2_word64)blocks * SHA256_BLOCK_LENGTH << 3;
+		len -= blocks * SHA256_BLOCK_LENGTH;
+		data += blocks * SHA256_BLOCK_LENGTH;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -590,7 +677,7 @@ void SHA256_Final(sha2_byte digest[], SHA256_CTX* context) {
 					MEMSET_BZERO(&context->buffer[usedspace], SHA256_BLOCK_LENGTH - usedspace);
 				}
 				/* Do second-to-last transform: */
-				SHA256_Transform(context, (sha2_word32*)context->buffer);
+				SHA256_Blocks(context, context->buffer, 1);
 
 				/* And set-up for the last transform: */
 				MEMSET_BZERO(context->buffer, SHA256_SHORT_BLOCK_LENGTH);
@@ -602,11 +689,11 @@ void SHA256_Final(sha2_byte digest[], SHA256_CTX* context) {
 			/* Begin padding with a 1 bit: */
 			*context->buffer = 0x80;
 		}
-		/* Set the bit count: */
-		*(sha2_word64*)&context->buffer[SHA256_SHORT_BLOCK_LENGTH] = context->bitcount;
+		/* Set the bit count (copied, the transform reads it as words): */
+		MEMCPY_BCOPY(&context->buffer[SHA256_SHORT_BLOCK_LENGTH], &context->bitcount, sizeof(sha2_word64));
 
 		/* Final transform: */
-		SHA256_Transform(context, (sha2_word32*)context->buffer);
+		SHA256_Blocks(context, context->buffer, 1);
 
 #if BYTE_ORDER == LITTLE_ENDIAN
 		{
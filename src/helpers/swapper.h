@@ -20,7 +20,12 @@
 #ifndef SWAPPER_H
 #define SWAPPER_H
 
-// used to make thread local, pointer-based config swaps by packet threads
+// used to make thread local, pointer-based config swaps by packet threads.
+// on reload, a swapper with the current config and host attributes is
+// published with the next epoch and the replaced ones are retired in
+// swappers that delete them once no packet thread is using that epoch.
+
+#include <stdint.h>
 
 struct SnortConfig;
 struct tTargetBasedConfig;
@@ -35,12 +40,20 @@ public:
 
     void apply();
 
+    void set_epoch(uint64_t e)
+    { epoch = e; }
+
+    uint64_t get_epoch() const
+    { return epoch; }
+
 private:
     SnortConfig* old_conf;
     SnortConfig* new_conf;
 
     tTargetBasedConfig* old_attribs;
     tTargetBasedConfig* new_attribs;
+
+    uint64_t epoch;
 };
 
 #endif
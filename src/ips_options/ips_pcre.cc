@@ -46,20 +46,21 @@
 #include "framework/parameter.h"
 #include "framework/module.h"
 
-#ifndef PCRE_STUDY_JIT_COMPILE
+// jit support was added in pcre 8.20 along with pcre_free_study();
+// use detection.pcre_jit = false to disable at runtime (eg for Xcode)
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define HAVE_PCRE_JIT
+#define pcre_release(x) pcre_free_study(x)
+#else
 #define PCRE_STUDY_JIT_COMPILE 0
-#endif
-
-#define NO_JIT // uncomment to disable JIT for Xcode
-
-#ifdef NO_JIT
-#define PCRE_STUDY_FLAGS 0
 #define pcre_release(x) pcre_free(x)
-#else
-#define PCRE_STUDY_FLAGS PCRE_STUDY_JIT_COMPILE
-#define pcre_release(x) pcre_free_study(x)
 #endif
 
+// the default jit stack is 32K on the machine stack which is too small
+// for many rules so each packet thread gets its own
+#define PCRE_JIT_STACK_MIN  (32 * 1024)
+#define PCRE_JIT_STACK_MAX  (512 * 1024)
+
 #define SNORT_PCRE_RELATIVE         0x00010 // relative to the end of the last match
 #define SNORT_PCRE_INVERT           0x00020 // invert detect
 #define SNORT_PCRE_ANCHORED         0x00040
@@ -86,11 +87,46 @@ static int s_ovector_max = 0;
 static int s_ovector_size = 0;
 
 static THREAD_LOCAL ProfileStats pcrePerfStats;
+static THREAD_LOCAL ProfileStats pcreJitPerfStats;
+static THREAD_LOCAL ProfileStats pcreInterpPerfStats;
+
+#ifdef HAVE_PCRE_JIT
+static THREAD_LOCAL pcre_jit_stack* s_jit_stack = nullptr;
+#endif
 
 //-------------------------------------------------------------------------
 // implementation foo
 //-------------------------------------------------------------------------
 
+#ifdef HAVE_PCRE_JIT
+// pcre calls this from pcre_exec() so each thread gets its own stack
+// (or the default machine stack if the allocation failed)
+static pcre_jit_stack* get_jit_stack(void*)
+{
+    return s_jit_stack;
+}
+#endif
+
+static void pcre_jit_check(PcreData* pcre_data)
+{
+    pcre_data->jit = false;
+
+#ifdef HAVE_PCRE_JIT
+    int jit = 0;
+
+    if ( !pcre_data->pe )
+        return;
+
+    // jit compilation may fail for a given pattern or the library may
+    // have been built without jit; either way pcre_exec() interprets
+    if ( pcre_fullinfo(pcre_data->re, pcre_data->pe, PCRE_INFO_JIT, &jit) or !jit )
+        return;
+
+    pcre_assign_jit_stack(pcre_data->pe, get_jit_stack, nullptr);
+    pcre_data->jit = true;
+#endif
+}
+
 static void pcre_capture(
     const void* code, const void* extra)
 {
@@ -266,7 +302,8 @@ static void pcre_parse(const char* data, PcreData* pcre_data)
     }
 
     /* now study it... */
-    pcre_data->pe = pcre_study(pcre_data->re, PCRE_STUDY_FLAGS, &error);
+    pcre_data->pe = pcre_study(pcre_data->re,
+        SnortConfig::get_pcre_jit() ? PCRE_STUDY_JIT_COMPILE : 0, &error);
 
     if (pcre_data->pe)
     {
@@ -334,6 +371,7 @@ static void pcre_parse(const char* data, PcreData* pcre_data)
 
     pcre_capture(pcre_data->re, pcre_data->pe);
     pcre_check_anchored(pcre_data);
+    pcre_jit_check(pcre_data);
 
     free(free_me);
     return;
@@ -385,6 +423,10 @@ static bool pcre_search(
     SnortState* ss = snort_conf->state + get_instance_id();
     assert(ss->pcre_ovector);
 
+    ProfileStats& exec_stats = pcre_data->jit ? pcreJitPerfStats : pcreInterpPerfStats;
+    PROFILE_VARS_NAMED(exec);
+    MODULE_PROFILE_START_NAMED(exec, exec_stats);
+
     result = pcre_exec(
         pcre_data->re,  /* result of pcre_compile() */
         pcre_data->pe,  /* result of pcre_study()   */
@@ -395,6 +437,8 @@ static bool pcre_search(
         ss->pcre_ovector,      /* vector for substring information */
         snort_conf->pcre_ovector_size); /* number of elements in the vector */
 
+    MODULE_PROFILE_END_NAMED(exec, exec_stats);
+
     if (result >= 0)
     {
         matched = true;
@@ -681,8 +725,7 @@ public:
     bool begin(const char*, int, SnortConfig*) override;
     bool set(const char*, Value&, SnortConfig*) override;
 
-    ProfileStats* get_profile() const override
-    { return &pcrePerfStats; }
+    ProfileStats* get_profile(unsigned, const char*&, const char*&) const override;
 
     PcreData* get_data();
 
@@ -690,6 +733,29 @@ private:
     PcreData* data;
 };
 
+ProfileStats* PcreModule::get_profile(
+    unsigned index, const char*& name, const char*& parent) const
+{
+    switch ( index )
+    {
+    case 0:
+        name = s_name;
+        parent = nullptr;
+        return &pcrePerfStats;
+
+    case 1:
+        name = "pcre_jit";
+        parent = s_name;
+        return &pcreJitPerfStats;
+
+    case 2:
+        name = "pcre_interp";
+        parent = s_name;
+        return &pcreInterpPerfStats;
+    }
+    return nullptr;
+}
+
 PcreData* PcreModule::get_data()
 {
     PcreData* tmp = data;
@@ -740,6 +806,24 @@ static void pcre_dtor(IpsOption* p)
     delete p;
 }
 
+static void pcre_tinit(SnortConfig*)
+{
+#ifdef HAVE_PCRE_JIT
+    if ( !s_jit_stack )
+        s_jit_stack = pcre_jit_stack_alloc(PCRE_JIT_STACK_MIN, PCRE_JIT_STACK_MAX);
+#endif
+}
+
+static void pcre_tterm(SnortConfig*)
+{
+#ifdef HAVE_PCRE_JIT
+    if ( s_jit_stack )
+        pcre_jit_stack_free(s_jit_stack);
+
+    s_jit_stack = nullptr;
+#endif
+}
+
 static void pcre_verify(SnortConfig* sc)
 {
     /* The pcre_fullinfo() function can be used to find out how many
@@ -775,8 +859,8 @@ static const IpsApi pcre_api =
     0, 0,
     nullptr,
     nullptr,
-    nullptr,
-    nullptr,
+    pcre_tinit,
+    pcre_tterm,
     pcre_ctor,
     pcre_dtor,
     pcre_verify
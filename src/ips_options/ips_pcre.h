@@ -29,6 +29,7 @@ struct PcreData
     pcre_extra* pe;     /* studied regex foo */
     int options;        /* sp_pcre specfic options (relative & inverse) */
     char* expression;
+    bool jit;           /* pe contains jit compiled code */
 };
 
 PcreData* pcre_get_data(void*);
@@ -32,13 +32,21 @@
 #endif
 
 #include <sys/types.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "framework/logger.h"
 #include "framework/module.h"
@@ -76,6 +84,12 @@ typedef struct _Unified2Config
     int nostamp;
     int mpls_event_types;
     int vlan_event_types;
+
+    // batched mode; disabled if batch_size == 0
+    unsigned int batch_size;
+    unsigned int max_latency;   // milliseconds
+    unsigned int ring_size;
+    bool backpressure;
 } Unified2Config;
 
 typedef struct _Unified2LogCallbackData
@@ -95,9 +109,34 @@ struct U2
     unsigned int current;
 };
 
+struct U2Stats
+{
+    PegCount records;
+    PegCount dropped;
+    PegCount waits;
+    PegCount batches;
+    PegCount max_batch;
+};
+
+const PegInfo u2_pegs[] =
+{
+    { "records", "unified2 records logged" },
+    { "dropped", "records dropped because the batch ring was full" },
+    { "backpressure", "times a packet thread waited for batch ring space" },
+    { "batches", "batched writes to the unified2 file" },
+    { "max batch", "largest batched write in bytes" },
+    { nullptr, nullptr }
+};
+
+class U2Writer;
+
 /* -------------------- Global Variables ----------------------*/
 
 static THREAD_LOCAL U2 u2;
+static THREAD_LOCAL U2Stats u2_stats;
+
+// packet thread only; always null on the writer thread
+static THREAD_LOCAL U2Writer* u2_writer = nullptr;
 
 /* Used for buffering header and payload of unified records so only one
  * write is necessary. */
@@ -128,6 +167,7 @@ static void Unified2InitFile(Unified2Config*);
 static inline void Unified2RotateFile(Unified2Config*);
 static void _Unified2LogPacketAlert(Packet*, const char*, Unified2Config*, Event*);
 static void Unified2Write(uint8_t*, uint32_t, Unified2Config*);
+static void Unified2Queue(const uint8_t*, uint32_t);
 
 static void _AlertIP4_v2(Packet*, const char*, Unified2Config*, Event*);
 static void _AlertIP6_v2(Packet*, const char*, Unified2Config*, Event*);
@@ -233,13 +273,6 @@ static void Unified2InitFile(Unified2Config* config)
     }
 }
 
-static inline void Unified2RotateFile(Unified2Config* config)
-{
-    fclose(u2.stream);
-    u2.current = 0;
-    Unified2InitFile(config);
-}
-
 static void _AlertIP4_v2(Packet* p, const char*, Unified2Config* config, Event* event)
 {
     Serial_Unified2_Header hdr;
@@ -758,6 +791,12 @@ static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config
     size_t fwcount = 0;
     int ffstatus = 0;
 
+    if ( u2_writer and buf )
+    {
+        Unified2Queue(buf, buf_len);
+        return;
+    }
+
     /* Nothing to write or nothing to write to */
     if ((buf == NULL) || (config == NULL) || (u2.stream == NULL))
         return;
@@ -903,6 +942,268 @@ static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config
     }
 
     u2.current += buf_len;
+    u2_stats.records++;
+}
+
+//-------------------------------------------------------------------------
+// batched writer
+// -- each packet thread appends records to its own byte ring instead of
+//    writing them
+// -- a writer thread drains the ring with writev() when batch_size bytes
+//    are pending or max_latency ms have passed
+// -- the writer thread has its own u2 state and does the file i/o,
+//    including rotation at the points marked by the packet thread
+// -- records are never split so a full ring either drops the record or,
+//    with backpressure, blocks the packet thread until there is space
+//-------------------------------------------------------------------------
+
+class U2Writer
+{
+public:
+    U2Writer(Unified2Config*);
+    ~U2Writer();
+
+    bool put(const uint8_t*, uint32_t);
+    void rotate();
+    void harvest();
+
+private:
+    void run(U2);
+    void write(uint64_t from, uint64_t to);
+
+private:
+    Unified2Config* config;
+
+    uint8_t* ring;
+    uint64_t head;  // total bytes put (packet thread)
+    uint64_t tail;  // total bytes written (writer thread)
+    std::deque<uint64_t> rotations;
+    bool done;
+
+    std::mutex lock;
+    std::condition_variable data_ready;
+    std::condition_variable space_ready;
+    std::thread* writer;
+
+    std::atomic<uint64_t> batches;
+    std::atomic<uint64_t> max_batch;
+};
+
+U2Writer::U2Writer(Unified2Config* c) : batches(0), max_batch(0)
+{
+    config = c;
+    ring = new uint8_t[config->ring_size];
+    head = tail = 0;
+    done = false;
+    writer = new std::thread(&U2Writer::run, this, u2);
+}
+
+U2Writer::~U2Writer()
+{
+    lock.lock();
+    done = true;
+    lock.unlock();
+
+    data_ready.notify_one();
+    writer->join();
+
+    delete writer;
+    delete[] ring;
+}
+
+bool U2Writer::put(const uint8_t* buf, uint32_t len)
+{
+    std::unique_lock<std::mutex> ul(lock);
+
+    if ( config->ring_size - (head - tail) < len )
+    {
+        data_ready.notify_one();
+
+        if ( !config->backpressure )
+            return false;
+
+        u2_stats.waits++;
+        space_ready.wait(ul, [&]{ return config->ring_size - (head - tail) >= len; });
+    }
+    uint64_t pos = head;
+    ul.unlock();
+
+    // the writer never reads past head so this is safe without the lock
+    unsigned off = pos % config->ring_size;
+    unsigned n = config->ring_size - off;
+
+    if ( n >= len )
+        memcpy(ring + off, buf, len);
+    else
+    {
+        memcpy(ring + off, buf, n);
+        memcpy(ring, buf + n, len - n);
+    }
+
+    ul.lock();
+    head += len;
+
+    if ( head - tail >= config->batch_size )
+        data_ready.notify_one();
+
+    return true;
+}
+
+void U2Writer::rotate()
+{
+    std::lock_guard<std::mutex> lg(lock);
+    rotations.push_back(head);
+}
+
+void U2Writer::harvest()
+{
+    u2_stats.batches += batches.exchange(0);
+
+    uint64_t max = max_batch.load();
+
+    if ( max > u2_stats.max_batch )
+        u2_stats.max_batch = max;
+}
+
+void U2Writer::write(uint64_t from, uint64_t to)
+{
+    unsigned off = from % config->ring_size;
+    unsigned len = to - from;
+    unsigned n = config->ring_size - off;
+
+    struct iovec iov[2];
+    int cnt = 1;
+
+    iov[0].iov_base = ring + off;
+
+    if ( n >= len )
+        iov[0].iov_len = len;
+    else
+    {
+        iov[0].iov_len = n;
+        iov[1].iov_base = ring;
+        iov[1].iov_len = len - n;
+        cnt = 2;
+    }
+
+    while ( cnt > 0 and u2.stream )
+    {
+        ssize_t rv = writev(fileno(u2.stream), iov, cnt);
+
+        if ( rv < 0 )
+        {
+            int error = errno;
+
+            if ( error == EINTR )
+                continue;
+
+            ErrorMessage("%s(%d) Failed to write to unified2 file (%s): %s\n",
+                __FILE__, __LINE__, u2.filepath, get_error(error));
+
+            // see Unified2Write(); a soft nfs mount may recover
+            if ( error != EIO )
+                FatalError("%s(%d) Cannot write to device.\n", __FILE__, __LINE__);
+
+            Unified2RotateFile(config);
+            continue;
+        }
+
+        // skip what was written, leaving the remainder in iov[0 .. cnt-1]
+        while ( cnt > 0 and (size_t)rv >= iov[0].iov_len )
+        {
+            rv -= iov[0].iov_len;
+            iov[0] = iov[1];
+            --cnt;
+        }
+        if ( cnt > 0 )
+        {
+            iov[0].iov_base = (uint8_t*)iov[0].iov_base + rv;
+            iov[0].iov_len -= rv;
+        }
+    }
+
+    batches++;
+
+    if ( len > max_batch.load() )
+        max_batch = len;
+}
+
+void U2Writer::run(U2 init)
+{
+    // writer thread has its own u2 and thus its own file
+    u2 = init;
+    Unified2InitFile(config);
+
+    std::chrono::milliseconds latency(config->max_latency);
+    std::unique_lock<std::mutex> ul(lock);
+
+    while ( true )
+    {
+        data_ready.wait_for(ul, latency,
+            [&]{ return done or head - tail >= config->batch_size; });
+
+        uint64_t end = head;
+        bool stop = done;
+
+        while ( tail < end or (!rotations.empty() and rotations.front() == tail) )
+        {
+            uint64_t to = end;
+
+            if ( !rotations.empty() and rotations.front() < to )
+                to = rotations.front();
+
+            if ( to > tail )
+            {
+                ul.unlock();
+                write(tail, to);
+                ul.lock();
+
+                tail = to;
+                space_ready.notify_one();
+            }
+            if ( !rotations.empty() and rotations.front() == tail )
+            {
+                rotations.pop_front();
+                ul.unlock();
+                Unified2RotateFile(config);
+                ul.lock();
+            }
+        }
+        if ( stop )
+            break;
+    }
+    ul.unlock();
+
+    if ( u2.stream )
+        fclose(u2.stream);
+}
+
+static void Unified2Queue(const uint8_t* buf, uint32_t len)
+{
+    if ( u2_writer->put(buf, len) )
+    {
+        u2.current += len;
+        u2_stats.records++;
+    }
+    else
+        u2_stats.dropped++;
+
+    u2_writer->harvest();
+}
+
+static inline void Unified2RotateFile(Unified2Config* config)
+{
+    u2.current = 0;
+
+    // the writer thread rotates when it gets to this point in the ring
+    if ( u2_writer )
+    {
+        u2_writer->rotate();
+        return;
+    }
+
+    fclose(u2.stream);
+    Unified2InitFile(config);
 }
 
 //-------------------------------------------------------------------------
@@ -926,6 +1227,18 @@ static const Parameter s_params[] =
     { "vlan_event_types", Parameter::PT_BOOL, nullptr, "false",
       "include vlan IDs in events" },
 
+    { "batch_size", Parameter::PT_INT, "0:16777216", "0",
+      "write records from a separate thread when this many bytes are queued (0 writes each record immediately)" },
+
+    { "max_latency", Parameter::PT_INT, "1:60000", "100",
+      "maximum milliseconds a batched record waits to be written" },
+
+    { "ring_size", Parameter::PT_INT, "1:1024", "4",
+      "size of the per thread batch ring in megabytes" },
+
+    { "backpressure", Parameter::PT_BOOL, nullptr, "false",
+      "wait for space when the batch ring is full instead of dropping records" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -941,12 +1254,26 @@ public:
     bool begin(const char*, int, SnortConfig*) override;
     bool end(const char*, int, SnortConfig*) override;
 
+    const PegInfo* get_pegs() const override
+    { return u2_pegs; }
+
+    PegCount* get_counts() const override
+    { return (PegCount*)&u2_stats; }
+
+    void sum_stats() override;
+    bool is_max_peg(unsigned) const override;
+
 public:
     unsigned limit;
     unsigned units;
     bool nostamp;
     bool mpls;
     bool vlan;
+
+    unsigned batch_size;
+    unsigned max_latency;
+    unsigned ring_size;
+    bool backpressure;
 };
 
 bool U2Module::set(const char*, Value& v, SnortConfig*)
@@ -966,6 +1293,18 @@ bool U2Module::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("vlan_event_types") )
         vlan = v.get_bool();
 
+    else if ( v.is("batch_size") )
+        batch_size = v.get_long();
+
+    else if ( v.is("max_latency") )
+        max_latency = v.get_long();
+
+    else if ( v.is("ring_size") )
+        ring_size = v.get_long() << 20;
+
+    else if ( v.is("backpressure") )
+        backpressure = v.get_bool();
+
     else
         return false;
 
@@ -978,6 +1317,11 @@ bool U2Module::begin(const char*, int, SnortConfig*)
     units = 0;
     nostamp = SnortConfig::output_no_timestamp();
     mpls = vlan = false;
+
+    batch_size = 0;
+    max_latency = 100;
+    ring_size = 4 << 20;
+    backpressure = false;
     return true;
 }
 
@@ -986,9 +1330,29 @@ bool U2Module::end(const char*, int, SnortConfig*)
     while ( units-- )
         limit *= 1024;
 
+    if ( batch_size and ring_size < batch_size + u2_buf_sz )
+    {
+        ParseError("unified2.ring_size must be at least %u bytes larger than batch_size",
+            u2_buf_sz);
+        return false;
+    }
     return true;
 }
 
+void U2Module::sum_stats()
+{
+    if ( u2_writer )
+        u2_writer->harvest();
+
+    Module::sum_stats();
+}
+
+// each writer's largest batch is combined across threads with max
+bool U2Module::is_max_peg(unsigned idx) const
+{
+    return idx == offsetof(U2Stats, max_batch) / sizeof(PegCount);
+}
+
 //-------------------------------------------------------------------------
 // logger stuff
 //-------------------------------------------------------------------------
@@ -1015,6 +1379,11 @@ U2Logger::U2Logger(U2Module* m)
     config.nostamp = m->nostamp;
     config.mpls_event_types = m->mpls;
     config.vlan_event_types = m->vlan;
+
+    config.batch_size = m->batch_size;
+    config.max_latency = m->max_latency;
+    config.ring_size = m->ring_size;
+    config.backpressure = m->backpressure;
 }
 
 U2Logger::~U2Logger()
@@ -1037,14 +1406,23 @@ void U2Logger::open()
     }
     u2.base_proto = htonl(DAQ_GetBaseProtocol());
 
-    Unified2InitFile(&config);
+    if ( config.batch_size )
+        u2_writer = new U2Writer(&config);
+    else
+        Unified2InitFile(&config);
 
     stream.reg_xtra_data_log(AlertExtraData, &config);
 }
 
 void U2Logger::close()
 {
-    if ( u2.stream )
+    if ( u2_writer )
+    {
+        // flushes the ring and closes the writer's file
+        delete u2_writer;
+        u2_writer = nullptr;
+    }
+    else if ( u2.stream )
         fclose(u2.stream);
 }
 
@@ -37,8 +37,10 @@
 #include <netinet/in.h>
 #endif
 
+#include <chrono>
 #include <string>
 #include <thread>
+#include <vector>
 using namespace std;
 
 #include "main/snort.h"
@@ -73,8 +75,6 @@ using namespace std;
 
 //-------------------------------------------------------------------------
 
-static Swapper* swapper = NULL;
-
 static int exit_logged = 0;
 static bool paused = false;
 static bool unknown_source = false;
@@ -112,6 +112,7 @@ Swapper::Swapper(SnortConfig* s, tTargetBasedConfig* t)
 
     old_attribs = nullptr;
     new_attribs = t;
+    epoch = 0;
 }
 
 Swapper::Swapper(SnortConfig* sold, SnortConfig* snew)
@@ -121,6 +122,7 @@ Swapper::Swapper(SnortConfig* sold, SnortConfig* snew)
 
     old_attribs = nullptr;
     new_attribs = nullptr;
+    epoch = 0;
 }
 
 Swapper::Swapper(tTargetBasedConfig* told, tTargetBasedConfig* tnew)
@@ -130,6 +132,7 @@ Swapper::Swapper(tTargetBasedConfig* told, tTargetBasedConfig* tnew)
 
     old_attribs = told;
     new_attribs = tnew;
+    epoch = 0;
 }
 
 Swapper::~Swapper()
@@ -228,18 +231,17 @@ public:
 
     Pig() { analyzer = nullptr; }
 
-    void start(unsigned, const char*, Swapper*);
+    void start(unsigned, const char*);
     void stop(unsigned);
 
     void execute(AnalyzerCommand);
-    void swap(Swapper*);
 };
 
-void Pig::start(unsigned idx, const char* source, Swapper* ps)
+void Pig::start(unsigned idx, const char* source)
 {
     LogMessage("++ [%u] %s\n", idx, source);
     analyzer = new Analyzer(source);
-    athread = new std::thread(std::ref(*analyzer), idx, ps);
+    athread = new std::thread(std::ref(*analyzer), idx);
 }
 
 void Pig::stop(unsigned idx)
@@ -262,17 +264,97 @@ void Pig::execute(AnalyzerCommand ac)
         analyzer->execute(ac);
 }
 
-void Pig::swap(Swapper* ps)
+static Pig* pigs = nullptr;
+static unsigned max_pigs = 0;
+
+//-------------------------------------------------------------------------
+// reload foo
+// -- packet threads pick up the published swapper on their own, between
+//    packets, so a reload never waits on them
+// -- whatever was replaced is retired at the epoch of the replacement and
+//    deleted once every thread holding a config is at or past that epoch
+//-------------------------------------------------------------------------
+
+// bounds the number of configs that may be alive at once
+#define RELOAD_MAX_RETIRED 4
+
+struct Retired
 {
-    if ( !analyzer )
-        return;
+    uint64_t epoch;
+    Swapper* swapper;
+};
+
+typedef std::chrono::steady_clock ReloadClock;
+
+static uint64_t reload_epoch = 1;   // below 2 is reserved by the analyzers
+static Swapper* published = nullptr;
+static std::vector<Retired> retired;
+
+static ReloadClock::time_point reload_start;
+static bool reload_visible = true;
+static uint64_t visible_usecs = 0;  // publish until all threads swapped
+static uint64_t overlap_usecs = 0;  // publish until last old config freed
 
-    analyzer->set_config(ps);
-    analyzer->execute(AC_SWAP);
+static uint64_t usecs_since(ReloadClock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        ReloadClock::now() - t).count();
 }
 
-static Pig* pigs = nullptr;
-static unsigned max_pigs = 0;
+static bool reload_pending()
+{
+    return retired.size() >= RELOAD_MAX_RETIRED;
+}
+
+// old is the delta being applied (and holds whatever it replaced); the
+// thread that picks up the new snapshot runs it so a swapper with just
+// the current config and attributes is published instead
+static void publish(Swapper* old)
+{
+    Swapper* ps = new Swapper(snort_conf, SFAT_GetConfig());
+    ps->set_epoch(++reload_epoch);
+
+    if ( published )
+        retired.push_back({ reload_epoch, published });
+
+    if ( old )
+        retired.push_back({ reload_epoch, old });
+
+    published = ps;
+    Analyzer::publish(ps);
+
+    reload_start = ReloadClock::now();
+    reload_visible = false;
+}
+
+// lowest epoch in use by a thread that holds a config; 0 if none
+static uint64_t min_epoch()
+{
+    uint64_t low = 0;
+
+    for ( unsigned idx = 0; idx < max_pigs; ++idx )
+    {
+        if ( !pigs[idx].analyzer )
+            continue;
+
+        uint64_t e = pigs[idx].analyzer->get_epoch();
+
+        if ( e and (!low or e < low) )
+            low = e;
+    }
+    return low;
+}
+
+static void reclaim_all()
+{
+    for ( auto& r : retired )
+        delete r.swapper;
+
+    retired.clear();
+
+    delete published;
+    published = nullptr;
+}
 
 //-------------------------------------------------------------------------
 // main commands
@@ -299,7 +381,7 @@ int main_rotate_stats(lua_State*)
 
 int main_reload_config(lua_State*)
 {
-    if ( swapper )
+    if ( reload_pending() )
     {
         request.respond("== reload pending; retry\n");
         return 0;
@@ -317,17 +399,13 @@ int main_reload_config(lua_State*)
     snort_conf = sc;
     proc_stats.conf_reloads++;
 
-    swapper = new Swapper(old, sc);
-
-    for ( unsigned idx = 0; idx < max_pigs; ++idx )
-        pigs[idx].swap(swapper);
-
+    publish(new Swapper(old, sc));
     return 0;
 }
 
 int main_reload_hosts(lua_State*)
 {
-    if ( swapper )
+    if ( reload_pending() )
     {
         request.respond("== reload pending; retry\n");
         return 0;
@@ -341,11 +419,33 @@ int main_reload_hosts(lua_State*)
         request.respond("== reload failed\n");
         return 0;
     }
-    swapper = new Swapper(old, tc);
+    publish(new Swapper(old, tc));
+    return 0;
+}
+
+int main_reload_status(lua_State*)
+{
+    string s = "== config epoch " + std::to_string(reload_epoch) + "\n";
 
     for ( unsigned idx = 0; idx < max_pigs; ++idx )
-        pigs[idx].swap(swapper);
+    {
+        if ( !pigs[idx].analyzer )
+            continue;
+
+        uint64_t e = pigs[idx].analyzer->get_epoch();
+        s += "   [" + std::to_string(idx) + "] ";
+        s += e ? std::to_string(e) : string("waiting");
+        s += "\n";
+    }
+    s += "   retired: " + std::to_string(retired.size()) + "\n";
+
+    if ( reload_visible )
+        s += "   visible usecs: " + std::to_string(visible_usecs) + "\n";
+    else
+        s += "   visible usecs: pending\n";
 
+    s += "   overlap usecs: " + std::to_string(overlap_usecs) + "\n";
+    request.respond(s.c_str());
     return 0;
 }
 
@@ -634,19 +734,44 @@ static bool service_users()
 
 static bool check_response()
 {
-    if ( !swapper )
+    if ( reload_visible and retired.empty() )
         return false;
 
-    for ( unsigned idx = 0; idx < max_pigs; ++idx )
+    // with no thread holding a config everything retired can go
+    uint64_t low = min_epoch();
+
+    if ( !low )
+        low = reload_epoch;
+
+    if ( !reload_visible and low >= reload_epoch )
     {
-        if ( pigs[idx].analyzer and pigs[idx].analyzer->swap_pending() )
-            return false;
+        visible_usecs = usecs_since(reload_start);
+        reload_visible = true;
     }
 
-    delete swapper;
-    swapper = nullptr;
+    unsigned n = 0;
+
+    for ( auto& r : retired )
+    {
+        if ( r.epoch <= low )
+            delete r.swapper;
+        else
+            retired[n++] = r;
+    }
+
+    if ( n == retired.size() )
+        return false;
+
+    retired.resize(n);
+
+    if ( n )
+        return false;
+
+    overlap_usecs = usecs_since(reload_start);
+
+    LogMessage("== reload complete (%lu usecs visible, %lu usecs overlap)\n",
+        (unsigned long)visible_usecs, (unsigned long)overlap_usecs);
 
-    LogMessage("== reload complete\n");
     return true;
 }
 
@@ -799,8 +924,7 @@ static void main_loop()
             }
             else if ( const char* src = get_source() )
             {
-                Swapper* swapper = new Swapper(snort_conf, SFAT_GetConfig());
-                pig.start(idx, src, swapper);
+                pig.start(idx, src);
                 ++swine;
                 continue;
             }
@@ -821,6 +945,9 @@ static void snort_main()
 
     pigs = new Pig[max_pigs];
 
+    publish(nullptr);
+    reload_visible = true;
+
     main_loop();
 
     for ( unsigned idx = 0; idx < max_pigs; ++idx )
@@ -833,6 +960,8 @@ static void snort_main()
     delete[] pigs;
     pigs = nullptr;
 
+    reclaim_all();
+
     TimeStop();
 #ifdef BUILD_SHELL
     socket_term();
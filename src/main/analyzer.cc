@@ -25,9 +25,11 @@
 using namespace std;
 
 #include "snort.h"
+#include "snort_config.h"
 #include "thread.h"
 #include "helpers/swapper.h"
 #include "packet_io/sfdaq.h"
+#include "utils/stats.h"
 
 typedef DAQ_Verdict
 (* PacketCallback)(void*, const DAQ_PktHdr_t*, const uint8_t*);
@@ -35,6 +37,68 @@ typedef DAQ_Verdict
 // FIXIT-M add fail open capability
 static THREAD_LOCAL PacketCallback main_func = Snort::packet_callback;
 
+//-------------------------------------------------------------------------
+// config epochs
+// -- the epoch published by a thread is the lowest it may be using so
+//    it is set to 1 (below any retired epoch) before loading the
+//    published swapper and only then to the epoch loaded
+// -- a thread waiting for packets holds no config and reports 0; it
+//    must not touch the old config again so current is cleared too
+//    (a deleted swapper may be reallocated at the same address)
+// -- the seq_cst store / load pairs here and in main ensure that either
+//    main sees a thread online or the thread sees the latest publish
+//-------------------------------------------------------------------------
+
+static std::atomic<Swapper*> published { nullptr };
+
+static THREAD_LOCAL Swapper* current = nullptr;
+static THREAD_LOCAL std::atomic<uint64_t>* thread_epoch = nullptr;
+
+void Analyzer::publish(Swapper* ps)
+{
+    published.store(ps);
+}
+
+static inline void refresh()
+{
+    Swapper* ps = published.load();
+
+    if ( ps == current )
+        return;
+
+    ps->apply();
+    current = ps;
+    thread_epoch->store(ps->get_epoch(), std::memory_order_release);
+}
+
+static inline void go_online()
+{
+    if ( current )
+        return;
+
+    thread_epoch->store(1);
+    refresh();
+}
+
+static inline void go_offline()
+{
+    current = nullptr;
+    thread_epoch->store(0, std::memory_order_release);
+}
+
+// every packet is a quiescent state; the swap is done before the packet
+// touches the config so the new config takes effect with the next packet
+static DAQ_Verdict packet_callback(
+    void* user, const DAQ_PktHdr_t* pkth, const uint8_t* pkt)
+{
+    if ( current )
+        refresh();
+    else
+        go_online();
+
+    return main_func(user, pkth, pkt);
+}
+
 //-------------------------------------------------------------------------
 // analyzer
 //-------------------------------------------------------------------------
@@ -45,14 +109,18 @@ Analyzer::Analyzer(const char* s)
     count = 0;
     source = s;
     command = AC_NONE;
-    swap = nullptr;
     daqh = nullptr;
+
+    // protect all configs until we pick one up
+    epoch = 1;
 }
 
-void Analyzer::operator()(unsigned id, Swapper* ps)
+void Analyzer::operator()(unsigned id)
 {
     set_instance_id(id);
-    ps->apply();
+
+    thread_epoch = &epoch;
+    go_online();
 
     pin_thread_to_cpu(source);
     Snort::thread_init(source);
@@ -62,7 +130,7 @@ void Analyzer::operator()(unsigned id, Swapper* ps)
 
     Snort::thread_term();
 
-    delete ps;
+    go_offline();
     done = true;
 }
 
@@ -109,21 +177,31 @@ bool Analyzer::handle(AnalyzerCommand ac)
         command = AC_NONE;
         break;
 
-    case AC_SWAP:
-        if ( swap )
-        {
-            swap->apply();
-            swap = nullptr;
-        }
-        command = AC_NONE;
-        break;
-
     default:
         break;
     }
     return true;
 }
 
+static void count_batch(PegCount pkts, chrono::steady_clock::time_point start)
+{
+    if ( !pkts )
+        return;
+
+    uint64_t usecs = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - start).count();
+
+    aux_counts.batches++;
+    aux_counts.batch_usecs += usecs;
+
+    unsigned i = 0;
+
+    for ( uint64_t max = 100; i < array_size(aux_counts.batch_time) - 1 and usecs >= max; max *= 10 )
+        ++i;
+
+    aux_counts.batch_time[i]++;
+}
+
 void Analyzer::analyze()
 {
     while ( true )
@@ -136,14 +214,28 @@ void Analyzer::analyze()
             if ( command == AC_PAUSE )
                 continue;
         }
-        if ( DAQ_Acquire(0, main_func, NULL) )
+        unsigned batch = SnortConfig::get_pkt_batch();
+        PegCount pkts = pc.total_from_daq;
+        auto start = chrono::steady_clock::now();
+
+        go_offline();
+        int err = DAQ_Acquire(batch, packet_callback, NULL);
+        go_online();
+
+        if ( err )
             break;
 
+        pkts = pc.total_from_daq - pkts;
+        count_batch(pkts, start);
+
+        // a full batch means more packets are likely waiting
+        if ( batch and pkts >= batch )
+            continue;
+
         // FIXIT-L acquire(0) won't return until no packets, signal, etc.
         // which makes this idle unlikely to execute under high traffic
-        // conditions; that means the idle processing may not be useful
-        // or that we need a hook to do things periodically even when
-        // traffic is available
+        // conditions; set daq.batch_size so commands are checked between
+        // batches
         Snort::thread_idle();
     }
 }
@@ -22,7 +22,14 @@
 
 // Analyzer provides the packet acquisition and processing loop.  Since it
 // runs in a different thread, it also provides a command facility so that
-// to control the thread and swap configuration.
+// to control the thread.
+//
+// configuration is swapped by publishing a Swapper which each packet
+// thread picks up before its next packet (or when it stops waiting for
+// packets).  each thread reports the epoch of the config it is using so
+// the main thread can tell when a replaced config may be deleted.
+
+#include <atomic>
 
 #include "main/snort_types.h"
 
@@ -33,7 +40,6 @@ enum AnalyzerCommand
     AC_PAUSE,
     AC_RESUME,
     AC_ROTATE,
-    AC_SWAP,
     AC_MAX
 };
 
@@ -44,7 +50,7 @@ class Analyzer
 public:
     Analyzer(const char* source);
 
-    void operator()(unsigned, Swapper*);
+    void operator()(unsigned);
 
     bool is_done() { return done; }
     uint64_t get_count() { return count; }
@@ -53,19 +59,24 @@ public:
     // FIXIT-M add asynchronous response too
     bool execute(AnalyzerCommand);
 
-    void set_config(Swapper* ps) { swap = ps; }
-    bool swap_pending() { return command == AC_SWAP; }
+    // epoch of the config in use: 0 while waiting for packets (no config
+    // is held) and 1 while picking up the published config
+    uint64_t get_epoch() const
+    { return epoch.load(); }
+
+    // main thread only; the swapper must stay put until retired
+    static void publish(Swapper*);
 
 private:
     void analyze();
     bool handle(AnalyzerCommand);
 
 private:
+    std::atomic<uint64_t> epoch;
     bool done;
     uint64_t count;
     const char* source;
     volatile AnalyzerCommand command;
-    Swapper* swap;
     void* daqh;
 };
 
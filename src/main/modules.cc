@@ -47,6 +47,7 @@ using namespace std;
 #include "filters/sfrf.h"
 #include "filters/rate_filter.h"
 #include "codecs/codec_module.h"
+#include "time/housekeeping_module.h"
 #include "time/ppm_module.h"
 #include "time/profiler.h"
 #include "parser/parse_ip.h"
@@ -78,6 +79,9 @@ static const Parameter detection_params[] =
     { "pcre_match_limit_recursion", Parameter::PT_INT, "-1:10000", "1500",
       "limit pcre stack consumption, -1 = max, 0 = off" },
 
+    { "pcre_jit", Parameter::PT_BOOL, nullptr, "true",
+      "jit compile pcre rule options if supported by libpcre" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -106,6 +110,9 @@ bool DetectionModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("pcre_match_limit_recursion") )
         sc->pcre_match_limit_recursion = v.get_long();
 
+    else if ( v.is("pcre_jit") )
+        sc->pcre_jit = v.get_bool();
+
     else
         return false;
 
@@ -180,7 +187,7 @@ bool EventQueueModule::set(const char*, Value& v, SnortConfig* sc)
 // FIXIT-L valid search methods should be obtained from available mpse plugins
 #define SEARCH_METHODS \
     "ac_banded | ac_bnfa | ac_bnfa_q | ac_full | ac_full_q | " \
-    "ac_sparse | ac_sparse_bands | ac_std"
+    "ac_sparse | ac_sparse_bands | ac_std | literal"
 
 static const Parameter search_engine_params[] =
 {
@@ -193,6 +200,9 @@ static const Parameter search_engine_params[] =
     { "enable_single_rule_group", Parameter::PT_BOOL, nullptr, "false",
       "put all rules into one group" },
 
+    { "compile_threads", Parameter::PT_INT, "0:", "0",
+      "maximum number of threads used to compile fast pattern groups (0 is one per core)" },
+
     { "debug", Parameter::PT_BOOL, nullptr, "false",
       "print verbose fast pattern info" },
 
@@ -226,6 +236,9 @@ static const Parameter search_engine_params[] =
     { "split_any_any", Parameter::PT_BOOL, nullptr, "false",
       "evaluate any-any rules separately to save memory" },
 
+    { "search_batch", Parameter::PT_BOOL, nullptr, "false",
+      "search all buffers of a packet with one call per state machine (faster only for large tables)" },
+
     { "search_optimize", Parameter::PT_BOOL, nullptr, "false",
       "tweak state machine construction for better performance" },
 
@@ -259,6 +272,9 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
         if ( v.get_bool() )
             fp->set_single_rule_group();
     }
+    else if ( v.is("compile_threads") )
+        fp->set_compile_threads(v.get_long());
+
     else if ( v.is("debug") )
     {
         if ( v.get_bool() )
@@ -304,6 +320,9 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("split_any_any") )
         fp->set_split_any_any(v.get_long());
 
+    else if ( v.is("search_batch") )
+        fp->set_search_batch(v.get_bool());
+
     else if ( v.is("search_optimize") )
         fp->set_search_opt(v.get_long());
 
@@ -872,6 +891,9 @@ static const Parameter daq_params[] =
     { "decode_data_link", Parameter::PT_BOOL, nullptr, "false",
       "display the second layer header info" },
 
+    { "batch_size", Parameter::PT_INT, "0:", "0",
+      "maximum packets processed per acquire before checking commands and housekeeping (0 is unlimited)" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -916,6 +938,9 @@ bool DaqModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("snaplen") )
         sc->pkt_snaplen = v.get_long();
 
+    else if ( v.is("batch_size") )
+        sc->pkt_batch = v.get_long();
+
     else
         return false;
 
@@ -1336,6 +1361,12 @@ static const Parameter file_id_params[] =
     { "file_rules", Parameter::PT_LIST, file_rule_params, nullptr,
         "list of file magic rules" },
 
+    { "capture_dir", Parameter::PT_STRING, nullptr, nullptr,
+      "write stored files to this directory" },
+
+    { "capture_queue_size", Parameter::PT_INT, "1:", "50",
+      "drop stored files while more than this many megabytes wait to be written" },
+
     { "trace_type", Parameter::PT_BOOL, nullptr, "false",
       "enable runtime dump of type info" },
 
@@ -1396,6 +1427,12 @@ bool FileIdModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("show_data_depth") )
         FileConfig::show_data_depth = v.get_long();
 
+    else if ( v.is("capture_dir") )
+        fc->file_capture_dir = v.get_string();
+
+    else if ( v.is("capture_queue_size") )
+        fc->file_capture_queue_size = v.get_long();
+
     else if ( v.is("trace_type") )
         FileConfig::trace_type = v.get_bool();
 
@@ -1997,6 +2034,7 @@ void module_init()
     ModuleManager::add_module(new DetectionModule);
     ModuleManager::add_module(new PacketsModule);
     ModuleManager::add_module(new ProcessModule);
+    ModuleManager::add_module(new HousekeepingModule);
 #ifdef PERF_PROFILING
     ModuleManager::add_module(new ProfileModule);
 #endif
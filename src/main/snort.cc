@@ -80,6 +80,7 @@ using namespace std;
 #include "filters/sfthreshold.h"
 #include "filters/rate_filter.h"
 #include "filters/detection_filter.h"
+#include "time/housekeeping.h"
 #include "time/packet_time.h"
 #include "time/ppm.h"
 #include "time/profiler.h"
@@ -98,6 +99,7 @@ using namespace std;
 #include "managers/codec_manager.h"
 #include "managers/action_manager.h"
 #include "control/idle_processing.h"
+#include "file_api/file_capture.h"
 #include "file_api/file_service.h"
 #include "flow/flow_control.h"
 #include "stream/stream.h"
@@ -599,8 +601,7 @@ DAQ_Verdict Snort::fail_open(
 
 void Snort::thread_idle()
 {
-    if ( flow_con )
-        flow_con->timeout_flows(16384, time(NULL));
+    housekeeping_idle();
     aux_counts.idle++;
 }
 
@@ -636,7 +637,10 @@ void Snort::thread_init(const char* intf)
     EventManager::open_outputs();
     IpsManager::setup_options();
     ActionManager::thread_init(snort_conf);
+    file_lib_tinit();
     InspectorManager::thread_init(snort_conf);
+
+    housekeeping_tinit();
 }
 
 void Snort::thread_term()
@@ -649,6 +653,10 @@ void Snort::thread_term()
 
     ModuleManager::accumulate(snort_conf);
     InspectorManager::thread_term(snort_conf);
+
+    // after the flows, and the files they hold, are released
+    file_capture_tterm();
+    file_lib_tterm();
     ActionManager::thread_term(snort_conf);
 
     IpsManager::clear_options();
@@ -835,6 +843,7 @@ DAQ_Verdict Snort::packet_callback(
     {
         flow_con->timeout_flows(4, pkthdr->ts.tv_sec);
     }
+    housekeeping_check();
 
     s_packet->pkth = nullptr;  // no longer avail upon sig segv
 
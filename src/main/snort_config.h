@@ -177,6 +177,7 @@ public:
     long int pcre_match_limit = 1500;
     long int pcre_match_limit_recursion = 1500;
     int pcre_ovector_size = 0;
+    bool pcre_jit = true;
 
     int asn1_mem = 0;
     uint32_t run_flags = 0;
@@ -210,6 +211,10 @@ public:
     uint8_t max_ip6_extensions = 0;
     uint8_t max_ip_layers = 0;
     int pkt_snaplen = -1;
+    uint32_t pkt_batch = 0;
+
+    unsigned housekeeping_budget = 50;
+    unsigned housekeeping_packets = 64;
 
     //------------------------------------------------------
     // active stuff
@@ -539,6 +544,18 @@ public:
     static long int get_pcre_match_limit_recursion()
     { return snort_conf->pcre_match_limit_recursion; }
 
+    static bool get_pcre_jit()
+    { return snort_conf->pcre_jit; }
+
+    static uint32_t get_pkt_batch()
+    { return snort_conf->pkt_batch; }
+
+    static unsigned get_housekeeping_budget()
+    { return snort_conf->housekeeping_budget; }
+
+    static unsigned get_housekeeping_packets()
+    { return snort_conf->housekeeping_packets; }
+
 #ifdef PERF_PROFILING
     static bool get_profile_modules()
     { return snort_conf->profile_modules; }
@@ -59,6 +59,7 @@ static const Command snort_cmds[] =
     { "dump_stats", main_dump_stats, "show summary statistics" },
     { "rotate_stats", main_rotate_stats, "roll perfmonitor log files" },
     { "reload_config", main_reload_config, "load new configuration" },
+    { "reload_status", main_reload_status, "show config epochs and reload timing" },
 
     // FIXIT-M need to load hosts from dedicated file
     //{ "reload_hosts", main_reload_hosts, "load a new hosts table" },
@@ -17,6 +17,7 @@
 //--------------------------------------------------------------------------
 // binder.cc author Russ Combs <rucombs@cisco.com>
 
+#include <map>
 #include <vector>
 using namespace std;
 
@@ -179,6 +180,139 @@ bool Binding::check_all(const Flow* flow) const
     return true;
 }
 
+//-------------------------------------------------------------------------
+// binding table
+//-------------------------------------------------------------------------
+
+// bindings are compiled into a table of candidate sets to avoid checking
+// each one in turn at flow setup.  for each of proto, port, vlan and iface
+// the possible values are grouped into classes that select the same
+// bindings and each class has a set with a bit per binding.  anding the
+// sets for a flow leaves the bindings that pass those checks; the policy,
+// addr and service checks are done on what is left, in binding order, so
+// the first match is the same as with a linear search.
+
+class BindTable
+{
+public:
+    void compile(const vector<Binding*>&);
+
+    // call f(i) for each binding i that passes the table checks, in
+    // order, until f returns true; returns false if the flow can't be
+    // looked up in the table
+    template<typename F>
+    bool find(const Flow*, F) const;
+
+private:
+    struct Dim
+    {
+        vector<uint16_t> map;   // value -> class
+        vector<uint64_t> sets;  // class -> words
+
+        const uint64_t* get(unsigned v, unsigned words) const
+        { return sets.data() + map[v] * words; }
+    };
+
+    template<typename Test>
+    void index(Dim&, unsigned num, const vector<Binding*>&, Test);
+
+private:
+    unsigned words = 0;
+
+    Dim proto;
+    Dim port;
+    Dim vlan;
+    Dim iface;
+};
+
+template<typename Test>
+void BindTable::index(Dim& d, unsigned num, const vector<Binding*>& v, Test test)
+{
+    map<vector<uint64_t>, uint16_t> classes;
+    vector<uint64_t> set(words), last;
+
+    d.map.resize(num);
+    d.sets.clear();
+
+    for ( unsigned val = 0; val < num; ++val )
+    {
+        std::fill(set.begin(), set.end(), 0);
+
+        for ( unsigned i = 0; i < v.size(); ++i )
+        {
+            if ( test(v[i], val) )
+                set[i / 64] |= 1ull << (i % 64);
+        }
+
+        // adjacent values (port ranges) usually select the same bindings
+        if ( val and set == last )
+        {
+            d.map[val] = d.map[val - 1];
+            continue;
+        }
+
+        auto it = classes.find(set);
+
+        if ( it == classes.end() )
+        {
+            it = classes.insert(make_pair(set, (uint16_t)classes.size())).first;
+            d.sets.insert(d.sets.end(), set.begin(), set.end());
+        }
+        d.map[val] = it->second;
+        last = set;
+    }
+}
+
+void BindTable::compile(const vector<Binding*>& v)
+{
+    words = (v.size() + 63) / 64;
+
+    index(proto, 256, v, [](const Binding* pb, unsigned val)
+        { return (pb->when.protos & val) != 0; });
+
+    index(port, 65536, v, [](const Binding* pb, unsigned val)
+        { return pb->when.ports.test(val); });
+
+    index(vlan, 4096, v, [](const Binding* pb, unsigned val)
+        { return pb->when.vlans.test(val); });
+
+    index(iface, 256, v, [](const Binding* pb, unsigned val)
+        { return pb->when.ifaces.test(val); });
+}
+
+template<typename F>
+bool BindTable::find(const Flow* flow, F f) const
+{
+    unsigned v = flow->key->vlan_tag;
+    int in = flow->iface_in < 0 ? 0 : flow->iface_in;
+    int out = flow->iface_out < 0 ? 0 : flow->iface_out;
+
+    if ( !words or v >= vlan.map.size() or
+        (unsigned)in >= iface.map.size() or (unsigned)out >= iface.map.size() )
+        return false;
+
+    const uint64_t* a = proto.get((unsigned)flow->protocol, words);
+    const uint64_t* b = port.get(flow->server_port, words);
+    const uint64_t* c = vlan.get(v, words);
+    const uint64_t* d = iface.get(in, words);
+    const uint64_t* e = iface.get(out, words);
+
+    for ( unsigned w = 0; w < words; ++w )
+    {
+        uint64_t m = a[w] & b[w] & c[w] & (d[w] | e[w]);
+
+        while ( m )
+        {
+            unsigned i = w * 64 + __builtin_ctzll(m);
+            m &= m - 1;
+
+            if ( f(i) )
+                return true;
+        }
+    }
+    return true;
+}
+
 //-------------------------------------------------------------------------
 // helpers
 //-------------------------------------------------------------------------
@@ -401,11 +535,13 @@ private:
 
     void set_binding(SnortConfig*, Binding*);
     void get_bindings(Flow*, Stuff&);
+    bool use_binding(Flow*, Stuff&, Binding*);
     void apply(Flow*, Stuff&);
     Inspector* find_gadget(Flow*);
 
 private:
     vector<Binding*> bindings;
+    BindTable table;
 };
 
 Binder::Binder(vector<Binding*>& v)
@@ -431,6 +567,7 @@ bool Binder::configure(SnortConfig* sc)
         if ( !pb->use.index )
             set_binding(sc, pb);
     }
+    table.compile(bindings);
     return true;
 }
 
@@ -513,38 +650,47 @@ void Binder::set_binding(SnortConfig*, Binding* pb)
         ParseError("can't bind %s", key);
 }
 
-// FIXIT-P this is a simple linear search until functionality is nailed
-// down.  performance should be the focus of the next iteration.
-void Binder::get_bindings(Flow* flow, Stuff& stuff)
+// returns true when the search is done
+bool Binder::use_binding(Flow* flow, Stuff& stuff, Binding* pb)
 {
-    Binding* pb;
-    unsigned i, sz = bindings.size();
+    if ( !pb->use.index )
+        return stuff.update(pb);
 
-    for ( i = 0; i < sz; i++ )
+    set_policies(snort_conf, pb->use.index - 1);
+    flow->policy_id = pb->use.index - 1;
+
+    Binder* sub = (Binder*)InspectorManager::get_binder();
+
+    if ( sub )
     {
-        pb = bindings[i];
+        sub->get_bindings(flow, stuff);
+        return true;
+    }
+    return false;
+}
 
-        if ( !pb->check_all(flow) )
-            continue;
+// the table narrows the search to the bindings that pass the proto, port,
+// vlan and iface checks; we fall back to a linear search for flows it
+// can't handle
+void Binder::get_bindings(Flow* flow, Stuff& stuff)
+{
+    bool found = table.find(flow, [&](unsigned i)
+    {
+        Binding* pb = bindings[i];
 
-        if ( !pb->use.index )
-        {
-            if ( stuff.update(pb) )
-                return;
-            else
-                continue;
-        }
+        if ( !pb->check_policy(flow) or !pb->check_addr(flow) or !pb->check_service(flow) )
+            return false;
 
-        set_policies(snort_conf, pb->use.index - 1);
-        flow->policy_id = pb->use.index - 1;
+        return use_binding(flow, stuff, pb);
+    });
 
-        Binder* sub = (Binder*)InspectorManager::get_binder();
+    if ( found )
+        return;
 
-        if ( sub )
-        {
-            sub->get_bindings(flow, stuff);
+    for ( auto* pb : bindings )
+    {
+        if ( pb->check_all(flow) and use_binding(flow, stuff, pb) )
             return;
-        }
     }
 }
 
@@ -1018,6 +1018,7 @@ static RuleTreeNode* ProcessHeadNode(
         head_count++;
 
         rtn = (RuleTreeNode*)SnortAlloc(sizeof(RuleTreeNode));
+        rtn->state = (RtnState*)SnortAlloc(sizeof(RtnState)*get_instance_max());
         rtn->otnRefCount++;
 
         /* copy the prototype header info into the new header block */
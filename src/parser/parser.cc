@@ -593,6 +593,9 @@ void FreeRuleTreeNode(RuleTreeNode* rtn)
         sfvar_free(rtn->dip);
     }
 
+    if (rtn->state)
+        free(rtn->state);
+
     idx = rtn->rule_func;
     while (idx)
     {
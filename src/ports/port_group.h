@@ -57,6 +57,13 @@ struct PortGroup
     // pattern matchers
     class Mpse* mpse[PM_TYPE_MAX];
 
+    // the matchers are compiled with ids in place of rule data so that
+    // groups with the same fast patterns, including those of a reloaded
+    // config, can share them; these map the ids to this group's rules
+    struct FpMatchers* matchers;
+    struct PMX* pmx;  // by pattern id
+    void** trees;     // by tree id
+
     // detection option tree
     void* nfp_tree;
 
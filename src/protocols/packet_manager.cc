@@ -20,6 +20,7 @@
 #include "protocols/packet_manager.h"
 
 #include <vector>
+#include <string>
 #include <cstring>
 #include <mutex>
 #include <algorithm>
@@ -76,6 +77,39 @@ const std::array<const char*, PacketManager::stat_offset> PacketManager::stat_na
     }
 };
 
+// the most common layer stacks after the data link layer.  these are
+// decoded without the bookkeeping for encapsulation, fragments, etc.
+// and counted once per packet instead of once per layer.  stacks with
+// the same prefix must be adjacent (keep them sorted).
+#define MAX_FAST_LAYERS 4
+
+struct FastStack
+{
+    // next_prot_id after each layer, ending with FINISHED_DECODE
+    uint16_t protos[MAX_FAST_LAYERS];
+};
+
+static const FastStack fast_stacks[] =
+{
+    { { ETHERTYPE_IPV4, IPPROTO_ID_ICMPV4, FINISHED_DECODE } },
+    { { ETHERTYPE_IPV4, IPPROTO_ID_TCP, FINISHED_DECODE } },
+    { { ETHERTYPE_IPV4, IPPROTO_ID_UDP, FINISHED_DECODE } },
+    { { ETHERTYPE_8021Q, ETHERTYPE_IPV4, IPPROTO_ID_TCP, FINISHED_DECODE } },
+    { { ETHERTYPE_8021Q, ETHERTYPE_IPV4, IPPROTO_ID_UDP, FINISHED_DECODE } },
+    { { ETHERTYPE_IPV6, IPPROTO_ID_TCP, FINISHED_DECODE } },
+    { { ETHERTYPE_IPV6, IPPROTO_ID_UDP, FINISHED_DECODE } },
+    { { ETHERTYPE_IPV6, IPPROTO_ID_ICMPV6, FINISHED_DECODE } },
+};
+
+static_assert(sizeof(fast_stacks)/sizeof(fast_stacks[0]) == PacketManager::num_fast_stacks,
+    "num_fast_stacks must match fast_stacks[]");
+
+THREAD_LOCAL std::array<PegCount, PacketManager::num_fast_stacks> PacketManager::s_fast_stats {
+    { 0 }
+};
+
+std::array<PegCount, PacketManager::num_fast_stacks> PacketManager::g_fast_stats;
+
 // Encoder Foo
 static THREAD_LOCAL Packet* encode_pkt = nullptr;
 static THREAD_LOCAL PegCount total_rebuilt_pkts = 0;
@@ -117,6 +151,22 @@ void PacketManager::pop_teredo(Packet* p, RawData& raw)
     raw.len += lyr_len;
 }
 
+// returns the first stack with the given proto at depth that shares the
+// prefix of stack cur, or num_fast_stacks if there is none
+static inline unsigned find_fast_stack(unsigned cur, unsigned depth, uint16_t proto)
+{
+    for ( unsigned s = cur; s < PacketManager::num_fast_stacks; ++s )
+    {
+        if ( depth && memcmp(fast_stacks[s].protos, fast_stacks[cur].protos,
+            depth * sizeof(fast_stacks[s].protos[0])) )
+            break;
+
+        if ( fast_stacks[s].protos[depth] == proto )
+            return s;
+    }
+    return PacketManager::num_fast_stacks;
+}
+
 //-------------------------------------------------------------------------
 // Initialization and setup
 //-------------------------------------------------------------------------
@@ -184,6 +234,155 @@ RawData::RawData(const DAQ_PktHdr_t* h, const uint8_t* p)
 //-------------------------------------------------------------------------
 // Encode/Decode functions
 //-------------------------------------------------------------------------
+// per layer bookkeeping after a successful decode
+void PacketManager::finish_layer(
+    Packet* p, RawData& raw, CodecData& cd, DecodeData& unsure_encap_ptrs,
+    uint8_t& mapped_prot, uint16_t& prev_prot_id)
+{
+    DEBUG_WRAP(DebugMessage(DEBUG_DECODE, "Codec %s (protocol_id: %u:"
+        "ip header starts at: %p, length is %lu\n",
+        CodecManager::s_protocols[mapped_prot]->get_name(),
+        cd.next_prot_id, raw.data, cd.lyr_len); );
+
+    /*
+     * We only want the layer immediately following SAVE_LAYER to have the
+     * UNSURE_ENCAP flag set.  So, if this is a SAVE_LAYER, zero out the
+     * bit and the next time around, when this is no longer SAVE_LAYER,
+     * we will zero out the UNSURE_ENCAP flag.
+     */
+    if (cd.codec_flags & CODEC_SAVE_LAYER)
+    {
+        cd.codec_flags &= ~CODEC_SAVE_LAYER;
+        unsure_encap_ptrs = p->ptrs;
+    }
+    else
+    {
+        cd.codec_flags &= ~CODEC_UNSURE_ENCAP;
+    }
+
+    if (cd.proto_bits & (PROTO_BIT__IP | PROTO_BIT__IP6_EXT))
+    {
+        // FIXIT-M refactor when ip_proto's become an array
+        if ( p->is_fragment() )
+        {
+            if ( prev_prot_id == IPPROTO_ID_FRAGMENT )
+            {
+                const ip::IP6Frag* const fragh =
+                    reinterpret_cast<const ip::IP6Frag*>(raw.data);
+                p->ip_proto_next = fragh->next();
+            }
+            else
+            {
+                p->ip_proto_next = p->ptrs.ip_api.get_ip4h()->proto();
+            }
+        }
+        else
+        {
+            p->ip_proto_next = (uint8_t)cd.next_prot_id;
+        }
+    }
+
+    // If we have reached the MAX_LAYERS, we keep decoding
+    // but no longer keep track of the layers.
+    if ( p->num_layers == CodecManager::max_layers )
+        SnortEventqAdd(GID_DECODE, DECODE_TOO_MANY_LAYERS);
+    else
+        push_layer(p, prev_prot_id, raw.data, cd.lyr_len);
+
+    // internal statistics and record keeping
+    s_stats[mapped_prot + stat_offset]++; // add correct decode for previous layer
+    mapped_prot = CodecManager::s_proto_map[cd.next_prot_id];
+    prev_prot_id = cd.next_prot_id;
+
+    // set for next call
+    const uint16_t curr_lyr_len = cd.lyr_len + cd.invalid_bytes;
+    assert(curr_lyr_len <= raw.len);
+    raw.len -= curr_lyr_len;
+    raw.data += curr_lyr_len;
+    p->proto_bits |= cd.proto_bits;
+    cd.next_prot_id = FINISHED_DECODE;
+    cd.lyr_len = 0;
+    cd.invalid_bytes = 0;
+    cd.proto_bits = 0;
+}
+
+// decode the layers while they follow one of the fast stacks.  returns
+// true if the generic loop should carry on from where this left off.
+bool PacketManager::fast_decode(
+    Packet* p, RawData& raw, CodecData& cd, DecodeData& unsure_encap_ptrs,
+    uint8_t& mapped_prot, uint16_t& prev_prot_id)
+{
+    uint8_t mapped[MAX_FAST_LAYERS];
+    unsigned stack = 0;
+    unsigned depth = 0;
+    bool more;
+
+    while ( true )
+    {
+        if ( !CodecManager::s_protocols[mapped_prot]->decode(raw, cd, p->ptrs) )
+        {
+            more = false;
+            break;
+        }
+
+        if ( (cd.codec_flags & CODEC_SAVE_LAYER) or cd.invalid_bytes or
+            p->num_layers == CodecManager::max_layers or
+            ((cd.proto_bits & (PROTO_BIT__IP | PROTO_BIT__IP6_EXT)) and p->is_fragment()) )
+        {
+            finish_layer(p, raw, cd, unsure_encap_ptrs, mapped_prot, prev_prot_id);
+            more = true;
+            break;
+        }
+
+        // the same as finish_layer() for a plain layer, less the stats
+        const uint16_t next = cd.next_prot_id;
+        cd.codec_flags &= ~CODEC_UNSURE_ENCAP;
+
+        if ( cd.proto_bits & (PROTO_BIT__IP | PROTO_BIT__IP6_EXT) )
+            p->ip_proto_next = (uint8_t)next;
+
+        push_layer(p, prev_prot_id, raw.data, cd.lyr_len);
+
+        mapped[depth] = mapped_prot;
+        mapped_prot = CodecManager::s_proto_map[next];
+        prev_prot_id = next;
+
+        assert(cd.lyr_len <= raw.len);
+        raw.len -= cd.lyr_len;
+        raw.data += cd.lyr_len;
+        p->proto_bits |= cd.proto_bits;
+        cd.next_prot_id = FINISHED_DECODE;
+        cd.lyr_len = 0;
+        cd.proto_bits = 0;
+
+        stack = find_fast_stack(stack, depth++, next);
+
+        if ( stack == num_fast_stacks )
+        {
+            // FINISHED_DECODE maps to the default codec which never decodes
+            more = (next != FINISHED_DECODE);
+            break;
+        }
+
+        if ( next == FINISHED_DECODE )
+        {
+            s_fast_stats[stack]++;
+            return false;
+        }
+
+        if ( depth == MAX_FAST_LAYERS )
+        {
+            more = true;
+            break;
+        }
+    }
+
+    for ( unsigned i = 0; i < depth; ++i )
+        s_stats[mapped[i] + stat_offset]++;
+
+    return more;
+}
+
 void PacketManager::decode(
     Packet* p, const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt, bool cooked)
 {
@@ -209,74 +408,10 @@ void PacketManager::decode(
     s_stats[total_processed]++;
 
     // loop until the protocol id is no longer valid
-    while (CodecManager::s_protocols[mapped_prot]->decode(raw, codec_data, p->ptrs))
-    {
-        DEBUG_WRAP(DebugMessage(DEBUG_DECODE, "Codec %s (protocol_id: %u:"
-            "ip header starts at: %p, length is %lu\n",
-            CodecManager::s_protocols[mapped_prot]->get_name(),
-            codec_data.next_prot_id, pkt, codec_data.lyr_len); );
+    bool more = fast_decode(p, raw, codec_data, unsure_encap_ptrs, mapped_prot, prev_prot_id);
 
-        /*
-         * We only want the layer immediately following SAVE_LAYER to have the
-         * UNSURE_ENCAP flag set.  So, if this is a SAVE_LAYER, zero out the
-         * bit and the next time around, when this is no longer SAVE_LAYER,
-         * we will zero out the UNSURE_ENCAP flag.
-         */
-        if (codec_data.codec_flags & CODEC_SAVE_LAYER)
-        {
-            codec_data.codec_flags &= ~CODEC_SAVE_LAYER;
-            unsure_encap_ptrs = p->ptrs;
-        }
-        else
-        {
-            codec_data.codec_flags &= ~CODEC_UNSURE_ENCAP;
-        }
-
-        if (codec_data.proto_bits & (PROTO_BIT__IP | PROTO_BIT__IP6_EXT))
-        {
-            // FIXIT-M refactor when ip_proto's become an array
-            if ( p->is_fragment() )
-            {
-                if ( prev_prot_id == IPPROTO_ID_FRAGMENT )
-                {
-                    const ip::IP6Frag* const fragh =
-                        reinterpret_cast<const ip::IP6Frag*>(raw.data);
-                    p->ip_proto_next = fragh->next();
-                }
-                else
-                {
-                    p->ip_proto_next = p->ptrs.ip_api.get_ip4h()->proto();
-                }
-            }
-            else
-            {
-                p->ip_proto_next = (uint8_t)codec_data.next_prot_id;
-            }
-        }
-
-        // If we have reached the MAX_LAYERS, we keep decoding
-        // but no longer keep track of the layers.
-        if ( p->num_layers == CodecManager::max_layers )
-            SnortEventqAdd(GID_DECODE, DECODE_TOO_MANY_LAYERS);
-        else
-            push_layer(p, prev_prot_id, raw.data, codec_data.lyr_len);
-
-        // internal statistics and record keeping
-        s_stats[mapped_prot + stat_offset]++; // add correct decode for previous layer
-        mapped_prot = CodecManager::s_proto_map[codec_data.next_prot_id];
-        prev_prot_id = codec_data.next_prot_id;
-
-        // set for next call
-        const uint16_t curr_lyr_len = codec_data.lyr_len + codec_data.invalid_bytes;
-        assert(curr_lyr_len <= raw.len);
-        raw.len -= curr_lyr_len;
-        raw.data += curr_lyr_len;
-        p->proto_bits |= codec_data.proto_bits;
-        codec_data.next_prot_id = FINISHED_DECODE;
-        codec_data.lyr_len = 0;
-        codec_data.invalid_bytes = 0;
-        codec_data.proto_bits = 0;
-    }
+    while ( more && CodecManager::s_protocols[mapped_prot]->decode(raw, codec_data, p->ptrs) )
+        finish_layer(p, raw, codec_data, unsure_encap_ptrs, mapped_prot, prev_prot_id);
 
     DEBUG_WRAP(DebugMessage(DEBUG_DECODE, "Codec %s (protocol_id: %hu: ip header"
         " starts at: %p, length is %lu\n",
@@ -914,6 +1049,29 @@ void PacketManager::dump_stats()
 
     show_percent_stats((PegCount*)&g_stats, &pkt_names[0],
         (unsigned int)pkt_names.size(), "codec");
+
+    // name the fast stacks by the codecs after the data link layer
+    std::vector<std::string> stacks;
+    std::vector<const char*> stack_names;
+
+    for ( const FastStack& fs : fast_stacks )
+    {
+        std::string name;
+
+        for ( unsigned i = 0; fs.protos[i] != FINISHED_DECODE; ++i )
+        {
+            if ( i )
+                name += "/";
+            name += get_proto_name(fs.protos[i]);
+        }
+        stacks.push_back(name);
+    }
+
+    for ( const std::string& name : stacks )
+        stack_names.push_back(name.c_str());
+
+    show_percent_stats((PegCount*)&g_fast_stats, &stack_names[0],
+        (unsigned int)stack_names.size(), "decode fast path");
 }
 
 void PacketManager::accumulate()
@@ -921,11 +1079,44 @@ void PacketManager::accumulate()
     static std::mutex stats_mutex;
 
     std::lock_guard<std::mutex> lock(stats_mutex);
+
+    // fast stack hits count for each of their layers
+    for ( unsigned s = 0; s < num_fast_stacks; ++s )
+    {
+        PegCount hits = s_fast_stats[s];
+
+        if ( !hits )
+            continue;
+
+        s_stats[CodecManager::grinder + stat_offset] += hits;
+
+        for ( unsigned i = 0; fast_stacks[s].protos[i] != FINISHED_DECODE; ++i )
+            s_stats[CodecManager::s_proto_map[fast_stacks[s].protos[i]] + stat_offset] += hits;
+    }
+
     sum_stats(&g_stats[0], &s_stats[0], s_stats.size());
+    sum_stats(&g_fast_stats[0], &s_fast_stats[0], s_fast_stats.size());
 
     // mutex is automatically unlocked
 }
 
+#ifdef UNIT_TEST
+void PacketManager::test_decode(
+    Packet* p, const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt, const char* dlt)
+{
+    const uint8_t grinder = CodecManager::grinder;
+
+    CodecManager::grinder = CodecManager::get_codec(dlt);
+    decode(p, pkthdr, pkt);
+    CodecManager::grinder = grinder;
+
+    accumulate();
+}
+
+PegCount PacketManager::test_count(const char* codec)
+{ return g_stats[CodecManager::get_codec(codec) + stat_offset]; }
+#endif
+
 const char* PacketManager::get_proto_name(uint16_t protocol)
 { return CodecManager::s_protocols[CodecManager::s_proto_map[protocol]]->get_name(); }
 
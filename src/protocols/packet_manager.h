@@ -146,12 +146,30 @@ public:
     static uint8_t proto_id(uint16_t proto)
     { return CodecManager::s_proto_map[proto]; }
 
+    // the number of common layer stacks decoded without the generic loop
+    static const uint8_t num_fast_stacks = 8;
+
+#ifdef UNIT_TEST
+    // decode starting with the named data link codec and accumulate the
+    // stats.  unit tests run on the main thread which has no grinder.
+    static void test_decode(Packet*, const struct _daq_pkthdr*, const uint8_t*, const char* dlt);
+
+    // the accumulated decode count of the named codec
+    static PegCount test_count(const char* codec);
+#endif
+
 private:
     // The only time we should accumulate is when CodecManager tells us too
     friend void CodecManager::thread_term();
     static void accumulate();
     static void pop_teredo(Packet*, RawData&);
 
+    static void finish_layer(Packet*, RawData&, CodecData&, DecodeData& unsure_encap_ptrs,
+        uint8_t& mapped_prot, uint16_t& prev_prot_id);
+
+    static bool fast_decode(Packet*, RawData&, CodecData&, DecodeData& unsure_encap_ptrs,
+        uint8_t& mapped_prot, uint16_t& prev_prot_id);
+
     static bool encode(const Packet* p, EncodeFlags,
         uint8_t lyr_start, uint8_t next_prot, Buffer& buf);
 
@@ -167,6 +185,10 @@ private:
     CodecManager::s_protocols.size()> s_stats;
     static std::array<PegCount, s_stats.size()> g_stats;
     static const std::array<const char*, stat_offset> stat_names;
+
+    // hits for each of the layer stacks decoded by fast_decode()
+    static THREAD_LOCAL std::array<PegCount, num_fast_stacks> s_fast_stats;
+    static std::array<PegCount, num_fast_stacks> g_fast_stats;
 };
 
 #endif
@@ -82,6 +82,12 @@ public:
             obj, (unsigned char*)T, n, match, data, current_state);
     }
 
+    int _search_batch(
+        MpseBatchItem* items, unsigned num, MpseMatch match) override
+    {
+        return acsmSearchBatch2(obj, items, num, match);
+    }
+
     int search_all(
         const unsigned char* T, int n, MpseMatch match,
         void* data, int* current_state) override
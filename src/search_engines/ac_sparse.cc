@@ -73,6 +73,12 @@ public:
             obj, (unsigned char*)T, n, match, data, current_state);
     }
 
+    int _search_batch(
+        MpseBatchItem* items, unsigned num, MpseMatch match) override
+    {
+        return acsmSearchBatch2(obj, items, num, match);
+    }
+
     int print_info() override
     {
         return acsmPrintDetailInfo2(obj);
@@ -60,13 +60,15 @@
 #include <string.h>
 #include <ctype.h>
 
+#include <atomic>
+
 #include "snort_debug.h"
 #include "util.h"
 #include "main/thread.h"
 
 #define MEMASSERT(p,s) if (!p) { fprintf(stderr,"ACSM-No Memory: %s\n",s); exit(0); }
 
-static int max_memory = 0;
+static std::atomic<int> max_memory { 0 };  // instances may be compiled concurrently
 
 static void* AC_MALLOC(int n)
 {
@@ -133,6 +133,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <assert.h>
+
+#include <atomic>
+#include <mutex>
 
 #include "snort_types.h"
 
@@ -145,37 +149,40 @@
 #include "pat_stats.h"
 #include "util.h"
 #include "snort_debug.h"
+#include "framework/mpse.h"
 
 #define printf LogMessage
 
 #define MEMASSERT(p,s) if (!p) { FatalError("ACSM-No Memory: %s\n",s); }
 
-static int acsm2_total_memory = 0;
-static int acsm2_pattern_memory = 0;
-static int acsm2_matchlist_memory = 0;
-static int acsm2_transtable_memory = 0;
-static int acsm2_dfa_memory = 0;
-static int acsm2_dfa1_memory = 0;
-static int acsm2_dfa2_memory = 0;
-static int acsm2_dfa4_memory = 0;
-static int acsm2_failstate_memory = 0;
+// instances may be compiled concurrently so the totals are atomic
+static std::atomic<int> acsm2_total_memory { 0 };
+static std::atomic<int> acsm2_pattern_memory { 0 };
+static std::atomic<int> acsm2_matchlist_memory { 0 };
+static std::atomic<int> acsm2_transtable_memory { 0 };
+static std::atomic<int> acsm2_dfa_memory { 0 };
+static std::atomic<int> acsm2_dfa1_memory { 0 };
+static std::atomic<int> acsm2_dfa2_memory { 0 };
+static std::atomic<int> acsm2_dfa4_memory { 0 };
+static std::atomic<int> acsm2_failstate_memory { 0 };
 static int s_verbose=0;
 
 typedef struct acsm_summary_s
 {
-    unsigned num_states;
-    unsigned num_transitions;
-    unsigned num_instances;
-    unsigned num_patterns;
-    unsigned num_characters;
-    unsigned num_match_states;
-    unsigned num_1byte_instances;
-    unsigned num_2byte_instances;
-    unsigned num_4byte_instances;
+    std::atomic<unsigned> num_states;
+    std::atomic<unsigned> num_transitions;
+    std::atomic<unsigned> num_instances;
+    std::atomic<unsigned> num_patterns;
+    std::atomic<unsigned> num_characters;
+    std::atomic<unsigned> num_match_states;
+    std::atomic<unsigned> num_1byte_instances;
+    std::atomic<unsigned> num_2byte_instances;
+    std::atomic<unsigned> num_4byte_instances;
     ACSM_STRUCT2 acsm;
 } acsm_summary_t;
 
 static acsm_summary_t summary;
+static std::mutex summary_mutex;  // for summary.acsm
 
 void acsm_init_summary(void)
 {
@@ -1799,7 +1806,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     {
         printf("ACSMX-Max Memory-TransTable Setup: %d bytes, %d states, "
             "%d active states\n",
-            acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+            acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
     }
 
     /* Alloc a MatchList table - this has a lis tof pattern matches for each state, if any */
@@ -1812,9 +1819,9 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     {
         printf("ACSMX-Max Memory- MatchList Table Setup: %d bytes, %d states, "
             "%d active states\n",
-            acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+            acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
         printf("ACSMX-Max Memory-Table Setup: %d bytes, %d states, %d active "
-            "states\n", acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+            "states\n", acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
     }
 
     /* Initialize state zero as a branch */
@@ -1871,7 +1878,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     {
         printf("ACSMX-Max Trie List Memory : %d bytes, %d states, %d "
             "active states\n",
-            acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+            acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
         List_PrintTransTable(acsm);
     }
 
@@ -1888,7 +1895,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
             printf("NFA-Trans-Nodes: %d\n",acsm->acsmNumTrans);
             printf("ACSMX-Max NFA List Memory  : %d bytes, %d states / %d "
                 "active states\n",
-                acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+                acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
             List_PrintTransTable(acsm);
         }
     }
@@ -1906,7 +1913,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
             printf("DFA-Trans-Nodes: %d\n",acsm->acsmNumTrans);
             printf("ACSMX-Max NFA-DFA List Memory  : %d bytes, %d states / %d "
                 "active states\n",
-                acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+                acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
             List_PrintTransTable(acsm);
         }
 
@@ -1933,7 +1940,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
         {
             printf ("ACSMX-Max Memory-Sparse: %d bytes, %d states, %d "
                 "active states\n",
-                acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+                acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
             Print_DFA(acsm);
         }
     }
@@ -1947,7 +1954,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
         {
             printf("ACSMX-Max Memory-banded: %d bytes, %d states, %d "
                 "active states\n",
-                acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+                acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
             Print_DFA(acsm);
         }
     }
@@ -1961,7 +1968,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
         {
             printf("ACSMX-Max Memory-sparse-bands: %d bytes, %d states, %d "
                 "active states\n",
-                acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+                acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
             Print_DFA(acsm);
         }
     }
@@ -1975,7 +1982,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
         {
             printf("ACSMX-Max Memory-Full: %d bytes, %d states, %d active "
                 "states\n",
-                acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+                acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
             Print_DFA(acsm);
         }
     }
@@ -1990,7 +1997,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     {
         printf("ACSMX-Max Memory-Final: %d bytes, %d states, %d active "
             "states\n",
-            acsm2_total_memory, acsm->acsmMaxStates, acsm->acsmNumStates);
+            acsm2_total_memory.load(), acsm->acsmMaxStates, acsm->acsmNumStates);
     }
 
     if (s_verbose)
@@ -2001,6 +2008,7 @@ static inline int _acsmCompile2(ACSM_STRUCT2* acsm)
     summary.num_transitions += acsm->acsmNumTrans;
     summary.num_instances++;
 
+    std::lock_guard<std::mutex> lock(summary_mutex);
     memcpy(&summary.acsm, acsm, sizeof(ACSM_STRUCT2));
 
     return 0;
@@ -2759,6 +2767,210 @@ int acsmSearchSparseDFA_Full_All(
     return nfound;
 }
 
+/*
+*   Batch DFA search
+*
+*   Up to AC_BATCH_LANES buffers are walked at once, a byte from each per
+*   pass, so the state table loads for one buffer overlap with those of
+*   the others instead of each stalling in turn.  Matches are queued and
+*   evaluated when the queue fills or the walks are done so that the rule
+*   trees don't evict the state tables.  Each buffer's matches are still
+*   delivered in order with the same index as the single buffer search.
+*
+*   Full_q is not batched since it must pass its matches through the
+*   _add_queue() dedup.  Batching is only used with search_batch = true
+*   because it is slower than the single buffer search when the state
+*   tables fit in cache.
+*/
+#define AC_BATCH_LANES 4
+#define AC_BATCH_QUEUE 256
+
+struct AcBatchLane
+{
+    const unsigned char* Tx;
+    const unsigned char* T;
+    const unsigned char* Tend;
+    unsigned item;
+    acstate_t state;
+};
+
+struct AcBatchMatch
+{
+    ACSM_PATTERN2* mlist;
+    int index;
+    unsigned item;
+};
+
+struct AcFullStep
+{
+    template <typename S>
+    static inline acstate_t next(S* ps, acstate_t, unsigned input)
+    { return ps[2u + input]; }
+};
+
+struct AcSparseStep
+{
+    static inline acstate_t next(acstate_t* ps, acstate_t state, unsigned input)
+    { return SparseGetNextStateDFA(ps, state, input); }
+};
+
+static void acsmFlushBatch(
+    AcBatchMatch* q, unsigned& nq, MpseBatchItem* items, MpseMatch match)
+{
+    for ( unsigned i = 0; i < nq; ++i )
+    {
+        MpseBatchItem& item = items[q[i].item];
+        ACSM_PATTERN2* mlist = q[i].mlist;
+
+        if ( item.stopped )
+            continue;
+
+        if (match(mlist->udata, mlist->rule_option_tree, q[i].index, item.data,
+            mlist->neg_list) > 0)
+            item.stopped = true;
+    }
+    nq = 0;
+}
+
+template <typename S, typename Step>
+static inline void acsmStepBatch(
+    ACSM_STRUCT2* acsm, S** NextState, AcBatchLane& ln,
+    AcBatchMatch* q, unsigned& nq, MpseBatchItem* items, MpseMatch match)
+{
+    S* ps = NextState[ln.state];
+
+    if ( ps[1] )
+    {
+        if ( ACSM_PATTERN2* mlist = acsm->acsmMatchList[ln.state] )
+        {
+            AcBatchMatch& m = q[nq++];
+            m.mlist = mlist;
+            m.index = ln.T - mlist->n - ln.Tx;
+            m.item = ln.item;
+            items[ln.item].nfound++;
+
+            if ( nq == AC_BATCH_QUEUE )
+                acsmFlushBatch(q, nq, items, match);
+        }
+    }
+    ln.state = Step::next(ps, ln.state, xlatcase[*ln.T++]);
+}
+
+template <typename S, typename Step>
+static int acsmSearchBatch(
+    ACSM_STRUCT2* acsm, S** NextState, MpseBatchItem* items, unsigned num,
+    MpseMatch match)
+{
+    AcBatchLane lane[AC_BATCH_LANES];
+    AcBatchMatch q[AC_BATCH_QUEUE];
+    unsigned nl = 0, nq = 0, next = 0;
+    int nfound = 0;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        items[i].nfound = 0;
+        items[i].stopped = false;
+    }
+
+    while ( true )
+    {
+        while ( nl < AC_BATCH_LANES && next < num )
+        {
+            AcBatchLane& ln = lane[nl++];
+            ln.Tx = ln.T = items[next].buf;
+            ln.Tend = ln.T + items[next].len;
+            ln.item = next++;
+            ln.state = 0;
+        }
+
+        if ( !nl )
+            break;
+
+        // step every lane as far as the shortest can go
+        long run = lane[0].Tend - lane[0].T;
+
+        for ( unsigned l = 1; l < nl; ++l )
+            if ( lane[l].Tend - lane[l].T < run )
+                run = lane[l].Tend - lane[l].T;
+
+        if ( nl == AC_BATCH_LANES )
+        {
+            for ( long r = 0; r < run; ++r )
+                for ( unsigned l = 0; l < AC_BATCH_LANES; ++l )
+                    acsmStepBatch<S, Step>(acsm, NextState, lane[l], q, nq, items, match);
+        }
+        else
+        {
+            for ( long r = 0; r < run; ++r )
+                for ( unsigned l = 0; l < nl; ++l )
+                    acsmStepBatch<S, Step>(acsm, NextState, lane[l], q, nq, items, match);
+        }
+
+        // check the last state of finished buffers and retire them
+        for ( unsigned l = 0; l < nl; )
+        {
+            AcBatchLane& ln = lane[l];
+
+            if ( ln.T < ln.Tend && !items[ln.item].stopped )
+            {
+                ++l;
+                continue;
+            }
+
+            ACSM_PATTERN2* mlist = acsm->acsmMatchList[ln.state];
+
+            if ( ln.T == ln.Tend && mlist )
+            {
+                AcBatchMatch& m = q[nq++];
+                m.mlist = mlist;
+                m.index = ln.T - mlist->n - ln.Tx;
+                m.item = ln.item;
+                items[ln.item].nfound++;
+
+                if ( nq == AC_BATCH_QUEUE )
+                    acsmFlushBatch(q, nq, items, match);
+            }
+            lane[l] = lane[--nl];
+        }
+    }
+
+    acsmFlushBatch(q, nq, items, match);
+
+    for ( unsigned i = 0; i < num; ++i )
+        nfound += items[i].nfound;
+
+    return nfound;
+}
+
+int acsmSearchBatch2(
+    ACSM_STRUCT2* acsm, MpseBatchItem* items, unsigned num, MpseMatch match)
+{
+    // full_q dedups its matches through _add_queue() so it isn't batched
+    assert(acsm->acsmFormat != ACF_FULLQ);
+
+    if ( acsm->acsmFormat != ACF_FULL )
+    {
+        return acsmSearchBatch<acstate_t, AcSparseStep>(
+            acsm, acsm->acsmNextState, items, num, match);
+    }
+
+    switch (acsm->sizeofstate)
+    {
+    case 1:
+        return acsmSearchBatch<uint8_t, AcFullStep>(
+            acsm, (uint8_t**)acsm->acsmNextState, items, num, match);
+
+    case 2:
+        return acsmSearchBatch<uint16_t, AcFullStep>(
+            acsm, (uint16_t**)acsm->acsmNextState, items, num, match);
+
+    default:
+        break;
+    }
+    return acsmSearchBatch<acstate_t, AcFullStep>(
+        acsm, acsm->acsmNextState, items, num, match);
+}
+
 /*
 *   Banded-Row format DFA search
 *   Do not change anything here, caching and prefetching
@@ -31,6 +31,8 @@
 
 #include "search_common.h"
 
+struct MpseBatchItem;
+
 #define MAX_ALPHABET_SIZE 256
 
 /*
@@ -192,6 +194,9 @@ int acsmSearchSparseDFA_Full_q_all(
     ACSM_STRUCT2*, const unsigned char* T, int n, MpseMatch,
     void* data, int* current_state);
 
+// DFA formats except full_q
+int acsmSearchBatch2(ACSM_STRUCT2*, MpseBatchItem*, unsigned num, MpseMatch);
+
 void acsmFree2(ACSM_STRUCT2* acsm);
 int acsmPatternCount2(ACSM_STRUCT2* acsm);
 void acsmCompressStates(ACSM_STRUCT2*, int);
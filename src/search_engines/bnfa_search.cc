@@ -151,6 +151,8 @@
 #include <string.h>
 #include <ctype.h>
 
+#include <mutex>
+
 #define BNFA_TRACK_Q
 
 #ifdef BNFA_TRACK_Q
@@ -225,8 +227,8 @@ static void bnfa_free(void* p, int n, int* m)
 #define BNFA_MALLOC(n,memory) (bnfa_state_t*)bnfa_alloc(n,&(memory))
 #define BNFA_FREE(p,n,memory) bnfa_free(p,n,&(memory))
 
-/* queue memory traker */
-static int queue_memory=0;
+/* queue memory traker; per thread since instances may be compiled concurrently */
+static THREAD_LOCAL int queue_memory=0;
 
 /*
 *    simple queue node
@@ -2477,6 +2479,7 @@ int bnfaPatternCount(bnfa_struct_t* p)
  */
 static bnfa_struct_t summary;
 static int summary_cnt = 0;
+static std::mutex summary_mutex;
 
 static void bnfaPrintInfoEx(bnfa_struct_t* p)
 {
@@ -2531,6 +2534,7 @@ void bnfaInitSummary(void)
 
 void bnfaAccumInfo(bnfa_struct_t* p)
 {
+    std::lock_guard<std::mutex> lock(summary_mutex);
     bnfa_struct_t* px = &summary;
 
     summary_cnt++;
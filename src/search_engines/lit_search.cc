@@ -0,0 +1,729 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// lit_search.cc
+
+#include "lit_search.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIT_X86
+#include <immintrin.h>
+#endif
+
+#include "log/messages.h"
+
+#define NO_GROUP 0xFFFFFFFF
+
+// above this many patterns (not counting 1 and 2 byte patterns) the hashed
+// filter is used instead of teddy
+#define LIT_TEDDY_MAX 64
+
+// the filters stop when the candidate buffer can't take another block
+#define LIT_CANDS 128
+
+struct LitCand
+{
+    uint32_t end;   // of the window
+    uint32_t keys;  // bit n set to verify n byte keys
+};
+
+// filters scan windows starting at pos until done or the candidate buffer
+// is full and return the number of candidates
+typedef unsigned (* LitFilter)(
+    const LitPrefilter&, const uint8_t*, unsigned len, unsigned& pos, LitCand*);
+
+static uint8_t xlatcase[256];
+
+static LitFilter teddy_filter = nullptr;
+
+// instances may be compiled concurrently
+static std::atomic<unsigned> lit_instances { 0 };
+static std::atomic<unsigned> lit_patterns { 0 };
+static std::atomic<unsigned> lit_groups { 0 };
+static std::atomic<unsigned> lit_teddy { 0 };
+
+static inline bool test_bit(const uint64_t* bits, unsigned i)
+{ return (bits[i >> 6] >> (i & 63)) & 1; }
+
+static inline void set_bit(uint64_t* bits, unsigned i)
+{ bits[i >> 6] |= (uint64_t)1 << (i & 63); }
+
+//-------------------------------------------------------------------------
+// teddy filter
+//-------------------------------------------------------------------------
+
+static inline unsigned teddy_bytes(
+    const LitPrefilter& f, const uint8_t* T, unsigned n, unsigned& pos,
+    LitCand* cand, unsigned num)
+{
+    unsigned last = n - LIT_WIDTH;
+
+    while ( pos <= last and num < LIT_CANDS )
+    {
+        unsigned b = 0xFF;
+
+        for ( unsigned k = 0; k < LIT_WIDTH; ++k )
+        {
+            uint8_t c = T[pos + k];
+            b &= f.lo[k][c & 0xF] & f.hi[k][c >> 4];
+        }
+        if ( b )
+        {
+            cand[num].end = pos + LIT_WIDTH;
+            cand[num++].keys = f.keys[b];
+        }
+        ++pos;
+    }
+    return num;
+}
+
+static unsigned teddy_scalar(
+    const LitPrefilter& f, const uint8_t* T, unsigned n, unsigned& pos, LitCand* cand)
+{
+    return teddy_bytes(f, T, n, pos, cand, 0);
+}
+
+#ifdef LIT_X86
+__attribute__((target("ssse3")))
+static unsigned teddy_ssse3(
+    const LitPrefilter& f, const uint8_t* T, unsigned n, unsigned& pos, LitCand* cand)
+{
+    const __m128i nib = _mm_set1_epi8(0xF);
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i lo[LIT_WIDTH], hi[LIT_WIDTH];
+
+    for ( unsigned k = 0; k < LIT_WIDTH; ++k )
+    {
+        lo[k] = _mm_loadu_si128((const __m128i*)f.lo[k]);
+        hi[k] = _mm_loadu_si128((const __m128i*)f.hi[k]);
+    }
+
+    unsigned num = 0;
+
+    while ( pos + 16 + LIT_WIDTH - 1 <= n and num + 16 <= LIT_CANDS )
+    {
+        __m128i r = _mm_set1_epi8(-1);
+
+        for ( unsigned k = 0; k < LIT_WIDTH; ++k )
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(T + pos + k));
+            __m128i l = _mm_shuffle_epi8(lo[k], _mm_and_si128(v, nib));
+            __m128i h = _mm_shuffle_epi8(hi[k], _mm_and_si128(_mm_srli_epi16(v, 4), nib));
+            r = _mm_and_si128(r, _mm_and_si128(l, h));
+        }
+        unsigned hits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(r, zero)) & 0xFFFF;
+
+        if ( hits )
+        {
+            uint8_t b[16];
+            _mm_storeu_si128((__m128i*)b, r);
+
+            while ( hits )
+            {
+                unsigned i = __builtin_ctz(hits);
+                cand[num].end = pos + i + LIT_WIDTH;
+                cand[num++].keys = f.keys[b[i]];
+                hits &= hits - 1;
+            }
+        }
+        pos += 16;
+    }
+    return teddy_bytes(f, T, n, pos, cand, num);
+}
+
+__attribute__((target("avx2")))
+static unsigned teddy_avx2(
+    const LitPrefilter& f, const uint8_t* T, unsigned n, unsigned& pos, LitCand* cand)
+{
+    const __m256i nib = _mm256_set1_epi8(0xF);
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i lo[LIT_WIDTH], hi[LIT_WIDTH];
+
+    for ( unsigned k = 0; k < LIT_WIDTH; ++k )
+    {
+        lo[k] = _mm256_loadu_si256((const __m256i*)f.lo[k]);
+        hi[k] = _mm256_loadu_si256((const __m256i*)f.hi[k]);
+    }
+
+    unsigned num = 0;
+
+    // vpshufb works within 128 bit lanes which is why the tables are doubled
+    while ( pos + 32 + LIT_WIDTH - 1 <= n and num + 32 <= LIT_CANDS )
+    {
+        __m256i r = _mm256_set1_epi8(-1);
+
+        for ( unsigned k = 0; k < LIT_WIDTH; ++k )
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(T + pos + k));
+            __m256i l = _mm256_shuffle_epi8(lo[k], _mm256_and_si256(v, nib));
+            __m256i h = _mm256_shuffle_epi8(
+                hi[k], _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+            r = _mm256_and_si256(r, _mm256_and_si256(l, h));
+        }
+        unsigned hits = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(r, zero));
+
+        if ( hits )
+        {
+            uint8_t b[32];
+            _mm256_storeu_si256((__m256i*)b, r);
+
+            while ( hits )
+            {
+                unsigned i = __builtin_ctz(hits);
+                cand[num].end = pos + i + LIT_WIDTH;
+                cand[num++].keys = f.keys[b[i]];
+                hits &= hits - 1;
+            }
+        }
+        pos += 32;
+    }
+    return teddy_bytes(f, T, n, pos, cand, num);
+}
+#endif
+
+//-------------------------------------------------------------------------
+// hashed filter
+//-------------------------------------------------------------------------
+
+// 0xDF folds letters; other bytes may collide with a neighbor which only
+// costs a verification
+template <bool shorts>
+static inline unsigned hash_scan(
+    const LitPrefilter& f, const uint8_t* T, unsigned n, unsigned& pos, LitCand* cand)
+{
+    const uint64_t* bits = f.bits.data();
+    unsigned last = n - f.key_len;
+    unsigned num = 0;
+
+    while ( pos <= last and num < LIT_CANDS )
+    {
+        uint32_t v = 0;
+
+        if ( pos + 4 <= n )
+            memcpy(&v, T + pos, 4);
+        else
+            memcpy(&v, T + pos, 3);
+
+        uint32_t h = ((v & f.key_mask) * 0x9E3779B1) >> f.shift;
+        unsigned keys = test_bit(bits, h) ? (1 << f.key_len) : 0;
+        unsigned end = pos + f.key_len;
+
+        if ( shorts )
+        {
+            unsigned c1 = T[end - 1] & 0xDF;
+            unsigned c2 = ((T[end - 2] & 0xDF) << 8) | c1;
+
+            if ( test_bit(f.short1, c1) )
+                keys |= 1 << 1;
+
+            if ( test_bit(f.short2.data(), c2) )
+                keys |= 1 << 2;
+        }
+        if ( keys )
+        {
+            cand[num].end = end;
+            cand[num++].keys = keys;
+        }
+        ++pos;
+    }
+    return num;
+}
+
+static unsigned hash_filter(
+    const LitPrefilter& f, const uint8_t* T, unsigned n, unsigned& pos, LitCand* cand)
+{
+    if ( f.short_keys )
+        return hash_scan<true>(f, T, n, pos, cand);
+
+    return hash_scan<false>(f, T, n, pos, cand);
+}
+
+//-------------------------------------------------------------------------
+// verification
+//-------------------------------------------------------------------------
+
+static inline uint32_t get_hash(const uint8_t* s, unsigned k, unsigned shift)
+{
+    uint32_t v = 0;
+
+    for ( unsigned i = 0; i < k; ++i )
+        v = (v << 8) | xlatcase[s[i]];
+
+    return (v * 0x9E3779B1) >> shift;
+}
+
+static inline bool same(const std::string& pat, const uint8_t* s)
+{
+    for ( unsigned i = 0; i < pat.size(); ++i )
+        if ( (uint8_t)pat[i] != xlatcase[s[i]] )
+            return false;
+
+    return true;
+}
+
+// keys are the last k bytes of the pattern so end is where matches end
+bool LitSearch::verify(
+    unsigned k, const uint8_t* T, unsigned end,
+    MpseMatch match, void* data, int& nfound)
+{
+    if ( k > end )
+        return false;
+
+    const LitTable& t = tables[k];
+    uint32_t g = t.heads[get_hash(T + end - k, k, t.shift)];
+
+    while ( g != NO_GROUP )
+    {
+        const LitGroup& lg = groups[g];
+        unsigned m = lg.pat.size();
+
+        if ( m <= end and same(lg.pat, T + end - m) )
+        {
+            nfound++;
+
+            if ( match(lg.udata, lg.tree, end - m, data, lg.neg_list) > 0 )
+                return true;
+        }
+        g = lg.next;
+    }
+    return false;
+}
+
+bool LitSearch::confirm(
+    unsigned keys, const uint8_t* T, unsigned end,
+    MpseMatch match, void* data, int& nfound)
+{
+    while ( keys )
+    {
+        unsigned k = __builtin_ctz(keys);
+        keys &= keys - 1;
+
+        if ( verify(k, T, end, match, data, nfound) )
+            return true;
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------------
+// compile
+//-------------------------------------------------------------------------
+
+static inline unsigned get_key_len(const LitPrefilter& f, const std::string& s)
+{ return s.size() < LIT_WIDTH ? s.size() : f.key_len; }
+
+// 1 and 2 byte patterns get the top buckets; the rest are sorted by their
+// reversed bytes so that similar suffixes share a bucket which keeps the
+// masks sparse
+void LitSearch::build_teddy()
+{
+    uint8_t bucket_key[LIT_BUCKETS];
+    unsigned top = LIT_BUCKETS;
+
+    for ( unsigned k = 1; k < LIT_WIDTH; ++k )
+    {
+        if ( pf.short_keys & (1 << k) )
+            bucket_key[--top] = k;
+    }
+
+    for ( unsigned b = 0; b < top; ++b )
+        bucket_key[b] = pf.key_len;
+
+    for ( unsigned m = 0; m < 256; ++m )
+    {
+        pf.keys[m] = 0;
+
+        for ( unsigned b = 0; b < LIT_BUCKETS; ++b )
+            if ( m & (1 << b) )
+                pf.keys[m] |= 1 << bucket_key[b];
+    }
+
+    std::vector<unsigned> bucket(groups.size());
+    std::vector<unsigned> order;
+
+    for ( unsigned g = 0; g < groups.size(); ++g )
+    {
+        unsigned n = groups[g].pat.size();
+
+        if ( n < LIT_WIDTH )
+            bucket[g] = std::find(bucket_key + top, bucket_key + LIT_BUCKETS, n) - bucket_key;
+        else
+            order.push_back(g);
+    }
+
+    std::sort(order.begin(), order.end(),
+        [this](unsigned a, unsigned b)
+        {
+            const std::string& x = groups[a].pat;
+            const std::string& y = groups[b].pat;
+            return std::lexicographical_compare(x.rbegin(), x.rend(), y.rbegin(), y.rend());
+        });
+
+    for ( unsigned i = 0; i < order.size(); ++i )
+        bucket[order[i]] = i * top / order.size();
+
+    for ( unsigned g = 0; g < groups.size(); ++g )
+    {
+        const std::string& s = groups[g].pat;
+        uint8_t bit = 1 << bucket[g];
+
+        bucket_groups[bucket[g]]++;
+
+        // the window is aligned with the end of the pattern
+        for ( unsigned k = 0; k < LIT_WIDTH; ++k )
+        {
+            if ( k + s.size() < LIT_WIDTH )
+            {
+                // short patterns match anything before their start
+                for ( unsigned i = 0; i < 16; ++i )
+                {
+                    pf.lo[k][i] |= bit;
+                    pf.hi[k][i] |= bit;
+                }
+                continue;
+            }
+            uint8_t x = s[s.size() - LIT_WIDTH + k];
+            uint8_t c[2] = { x, (uint8_t)tolower(x) };
+
+            for ( auto x : c )
+            {
+                pf.lo[k][x & 0xF] |= bit;
+                pf.hi[k][x >> 4] |= bit;
+            }
+        }
+    }
+
+    for ( unsigned k = 0; k < LIT_WIDTH; ++k )
+    {
+        memcpy(pf.lo[k] + 16, pf.lo[k], 16);
+        memcpy(pf.hi[k] + 16, pf.hi[k], 16);
+    }
+}
+
+void LitSearch::build_bitmaps(unsigned num_long)
+{
+    // about 1 bit in 64 set
+    unsigned bits = 12;
+
+    while ( (1u << bits) < 64 * num_long and bits < 24 )
+        ++bits;
+
+    pf.bits.assign((1 << bits) / 64, 0);
+    pf.shift = 32 - bits;
+
+    uint8_t m[4] = { 0xDF, 0xDF, 0xDF, 0xDF };
+
+    if ( pf.key_len < 4 )
+        m[3] = 0;
+
+    memcpy(&pf.key_mask, m, 4);
+
+    if ( pf.short_keys )
+        pf.short2.assign(65536 / 64, 0);
+
+    for ( auto& lg : groups )
+    {
+        const uint8_t* s = (const uint8_t*)lg.pat.data();
+        unsigned m = lg.pat.size();
+
+        if ( m == 1 )
+            set_bit(pf.short1, s[0] & 0xDF);
+
+        else if ( m == 2 )
+            set_bit(pf.short2.data(), ((s[0] & 0xDF) << 8) | (s[1] & 0xDF));
+
+        else
+        {
+            uint32_t v = 0;
+            memcpy(&v, s + m - pf.key_len, pf.key_len);
+            set_bit(pf.bits.data(), ((v & pf.key_mask) * 0x9E3779B1) >> pf.shift);
+        }
+    }
+}
+
+void LitSearch::build_tables()
+{
+    unsigned counts[LIT_KEY + 1] = { 0 };
+
+    for ( auto& lg : groups )
+        counts[get_key_len(pf, lg.pat)]++;
+
+    for ( unsigned k = 1; k <= LIT_KEY; ++k )
+    {
+        if ( !counts[k] )
+            continue;
+
+        // at least twice as many heads as groups
+        unsigned bits = 4;
+
+        while ( (1u << bits) < 2 * counts[k] )
+            ++bits;
+
+        tables[k].heads.assign(1 << bits, NO_GROUP);
+        tables[k].shift = 32 - bits;
+    }
+
+    // insert in reverse so chains are in add order
+    for ( unsigned g = groups.size(); g > 0; --g )
+    {
+        LitGroup& lg = groups[g - 1];
+        unsigned k = get_key_len(pf, lg.pat);
+        LitTable& t = tables[k];
+        const uint8_t* key = (const uint8_t*)lg.pat.data() + lg.pat.size() - k;
+        uint32_t h = get_hash(key, k, t.shift);
+
+        lg.next = t.heads[h];
+        t.heads[h] = g - 1;
+    }
+}
+
+int LitSearch::compile(SnortConfig* sc, MpseBuild build_tree, MpseNegate neg_list)
+{
+    std::unordered_map<std::string, unsigned> index;
+
+    for ( auto& p : patterns )
+    {
+        if ( index.find(p.pat) == index.end() )
+        {
+            index[p.pat] = groups.size();
+            groups.push_back({ p.pat, NO_GROUP, p.udata, nullptr, nullptr });
+        }
+    }
+
+    if ( build_tree and neg_list )
+    {
+        for ( auto& p : patterns )
+        {
+            LitGroup& lg = groups[index[p.pat]];
+
+            if ( !p.udata )
+                continue;
+
+            if ( p.negative )
+                neg_list(p.udata, &lg.neg_list);
+            else
+                build_tree(sc, p.udata, &lg.tree);
+        }
+
+        // last call to finalize the tree
+        for ( auto& lg : groups )
+            build_tree(sc, nullptr, &lg.tree);
+    }
+
+    unsigned num_long = 0;
+    pf.key_len = LIT_KEY;
+
+    for ( auto& lg : groups )
+    {
+        unsigned n = lg.pat.size();
+
+        if ( n < LIT_WIDTH )
+            pf.short_keys |= 1 << n;
+        else
+        {
+            pf.key_len = std::min(pf.key_len, n);
+            num_long++;
+        }
+    }
+
+    pf.teddy = (num_long <= LIT_TEDDY_MAX);
+
+    if ( pf.teddy )
+    {
+        pf.key_len = LIT_WIDTH;
+        build_teddy();
+    }
+    else
+        build_bitmaps(num_long);
+
+    build_tables();
+
+    lit_patterns += patterns.size();
+    lit_groups += groups.size();
+
+    if ( pf.teddy )
+        lit_teddy++;
+
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+// public methods
+//-------------------------------------------------------------------------
+
+LitSearch::LitSearch(
+    void (* uf)(void*), void (* tf)(void**), void (* lf)(void**))
+{
+    memset(pf.lo, 0, sizeof(pf.lo));
+    memset(pf.hi, 0, sizeof(pf.hi));
+    memset(pf.keys, 0, sizeof(pf.keys));
+    memset(pf.short1, 0, sizeof(pf.short1));
+    memset(bucket_groups, 0, sizeof(bucket_groups));
+
+    pf.shift = pf.key_mask = 0;
+    pf.key_len = LIT_KEY;
+    pf.short_keys = 0;
+    pf.teddy = true;
+
+    user_free = uf;
+    tree_free = tf;
+    list_free = lf;
+
+    lit_instances++;
+}
+
+LitSearch::~LitSearch()
+{
+    for ( auto& lg : groups )
+    {
+        if ( lg.tree and tree_free )
+            tree_free(&lg.tree);
+
+        if ( lg.neg_list and list_free )
+            list_free(&lg.neg_list);
+    }
+
+    for ( auto& p : patterns )
+    {
+        if ( p.udata and user_free )
+            user_free(p.udata);
+    }
+}
+
+void LitSearch::add(const uint8_t* pat, unsigned n, bool negative, void* udata)
+{
+    std::string s(n, '\0');
+
+    for ( unsigned i = 0; i < n; ++i )
+        s[i] = xlatcase[pat[i]];
+
+    patterns.push_back({ s, negative, udata });
+}
+
+int LitSearch::search(const uint8_t* T, unsigned n, MpseMatch match, void* data)
+{
+    int nfound = 0;
+
+    if ( groups.empty() )
+        return 0;
+
+    // windows end at key_len or later so the first few bytes are only
+    // checked for short patterns
+    for ( unsigned end = 1; end < pf.key_len and end <= n; ++end )
+    {
+        for ( unsigned k = 1; k <= end; ++k )
+        {
+            if ( (pf.short_keys & (1 << k)) and verify(k, T, end, match, data, nfound) )
+                return nfound;
+        }
+    }
+
+    if ( n < pf.key_len )
+        return nfound;
+
+    LitFilter filter = pf.teddy ? teddy_filter : hash_filter;
+    LitCand cand[LIT_CANDS];
+    unsigned pos = 0;
+
+    while ( pos <= n - pf.key_len )
+    {
+        unsigned num = filter(pf, T, n, pos, cand);
+
+        for ( unsigned i = 0; i < num; ++i )
+        {
+            if ( confirm(cand[i].keys, T, cand[i].end, match, data, nfound) )
+                return nfound;
+        }
+    }
+    return nfound;
+}
+
+void LitSearch::print_info()
+{
+    unsigned heads = 0;
+
+    for ( unsigned k = 1; k <= LIT_KEY; ++k )
+        heads += tables[k].heads.size();
+
+    LogMessage("+--[Literal Search Info]------------------------\n");
+    LogMessage("| Patterns : %zu\n", patterns.size());
+    LogMessage("| Groups   : %zu\n", groups.size());
+    LogMessage("| Heads    : %u\n", heads);
+    LogMessage("| Key len  : %u\n", pf.key_len);
+
+    if ( pf.teddy )
+    {
+        for ( unsigned b = 0; b < LIT_BUCKETS; ++b )
+            LogMessage("| Bucket %u : %u groups\n", b, bucket_groups[b]);
+    }
+    else
+        LogMessage("| Bitmap   : %zu bytes\n", pf.bits.size() * sizeof(uint64_t));
+
+    LogMessage("+-----------------------------------------------\n");
+}
+
+void LitSearch::init()
+{
+    for ( unsigned i = 0; i < 256; ++i )
+        xlatcase[i] = (uint8_t)toupper(i);
+
+    teddy_filter = teddy_scalar;
+
+#ifdef LIT_X86
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+        teddy_filter = teddy_avx2;
+
+    else if ( __builtin_cpu_supports("ssse3") )
+        teddy_filter = teddy_ssse3;
+#endif
+}
+
+void LitSearch::print_summary()
+{
+    const char* simd = "none";
+
+#ifdef LIT_X86
+    if ( teddy_filter == teddy_avx2 )
+        simd = "avx2";
+
+    else if ( teddy_filter == teddy_ssse3 )
+        simd = "ssse3";
+#endif
+
+    LogMessage("+--[Literal Search Summary]---------------------\n");
+    LogMessage("| Instances : %u\n", lit_instances.load());
+    LogMessage("| Teddy     : %u\n", lit_teddy.load());
+    LogMessage("| Patterns  : %u\n", lit_patterns.load());
+    LogMessage("| Groups    : %u\n", lit_groups.load());
+    LogMessage("| SIMD      : %s\n", simd);
+    LogMessage("+-----------------------------------------------\n");
+}
+
@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// lit_search.h
+
+#ifndef LIT_SEARCH_H
+#define LIT_SEARCH_H
+
+// LitSearch is a two stage literal matcher for large pattern sets.  the
+// first stage finds the positions where a pattern may end and the second
+// hashes the last (up to 4) bytes there and checks the patterns on that
+// chain.  keying on the end of the pattern works better than the start
+// because fast patterns often begin with something common like "GET /".
+//
+// small sets use a teddy style filter: patterns are split into 8 buckets
+// and for each of the last 3 pattern bytes there is a pair of 16 entry
+// tables, indexed by the low and high nibble of the input byte, that give
+// the set of buckets with that nibble at that offset.  anding the lookups
+// for 3 consecutive input bytes gives the buckets that may have a match
+// ending there.  the lookups are done 16 or 32 positions at a time with
+// pshufb when the cpu has ssse3 / avx2 and a byte at a time otherwise.
+//
+// teddy saturates once there are more than a few patterns per bucket so
+// larger sets use a bitmap indexed by a hash of the last bytes instead,
+// sized so that around 1 in 64 bits are set.
+//
+// 1 and 2 byte patterns are kept out of the way of the rest: they get
+// their own teddy buckets with wildcards before their start or their own
+// bitmaps.
+//
+// like acsmx2, matching is case insensitive; patterns with the same case
+// folded bytes share a rule option tree and negation list.  matches are
+// reported in order of their end position.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "framework/mpse.h"
+
+#define LIT_BUCKETS 8
+#define LIT_WIDTH 3
+#define LIT_KEY 4
+
+struct LitPattern
+{
+    std::string pat;  // case folded
+    bool negative;
+    void* udata;
+};
+
+struct LitGroup
+{
+    std::string pat;  // case folded
+    uint32_t next;    // hash chain
+    void* udata;
+    void* tree;
+    void* neg_list;
+};
+
+struct LitPrefilter
+{
+    // teddy; duplicated to 32 bytes for avx2
+    uint8_t lo[LIT_WIDTH][32];
+    uint8_t hi[LIT_WIDTH][32];
+    uint8_t keys[256];   // key lengths to verify by bucket set
+
+    // hashed
+    std::vector<uint64_t> bits;
+    unsigned shift;
+    uint32_t key_mask;   // key_len bytes, case folded
+
+    uint64_t short1[4];
+    std::vector<uint64_t> short2;
+
+    unsigned key_len;    // window size; key length of the longer patterns
+    unsigned short_keys; // bit n set if there are n byte patterns, n < LIT_WIDTH
+    bool teddy;
+};
+
+struct LitTable
+{
+    std::vector<uint32_t> heads;
+    unsigned shift;
+};
+
+class LitSearch
+{
+public:
+    LitSearch(
+        void (* user_free)(void*),
+        void (* tree_free)(void**),
+        void (* list_free)(void**));
+
+    ~LitSearch();
+
+    void add(const uint8_t* pat, unsigned len, bool negative, void* udata);
+    int compile(SnortConfig*, MpseBuild, MpseNegate);
+
+    int search(const uint8_t*, unsigned len, MpseMatch, void* data);
+
+    unsigned get_pattern_count()
+    { return patterns.size(); }
+
+    void print_info();
+
+    static void init();
+    static void print_summary();
+
+private:
+    void build_teddy();
+    void build_bitmaps(unsigned num_long);
+    void build_tables();
+
+    bool confirm(unsigned keys, const uint8_t*, unsigned end, MpseMatch, void*, int& nfound);
+    bool verify(unsigned key_len, const uint8_t*, unsigned end, MpseMatch, void*, int& nfound);
+
+private:
+    LitPrefilter pf;
+    unsigned bucket_groups[LIT_BUCKETS];
+
+    std::vector<LitPattern> patterns;
+    std::vector<LitGroup> groups;
+    LitTable tables[LIT_KEY + 1];  // by key length
+
+    void (* user_free)(void*);
+    void (* tree_free)(void**);
+    void (* list_free)(void**);
+};
+
+#endif
+
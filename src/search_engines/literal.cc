@@ -0,0 +1,152 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// literal.cc
+
+#include "lit_search.h"
+
+#include "snort_types.h"
+#include "framework/mpse.h"
+
+//-------------------------------------------------------------------------
+// "literal"
+//-------------------------------------------------------------------------
+
+class LiteralMpse : public Mpse
+{
+private:
+    LitSearch* obj;
+
+public:
+    LiteralMpse(
+        SnortConfig*,
+        bool use_gc,
+        void (* user_free)(void*),
+        void (* tree_free)(void**),
+        void (* list_free)(void**))
+        : Mpse("literal", use_gc)
+    {
+        obj = new LitSearch(user_free, tree_free, list_free);
+    }
+
+    ~LiteralMpse()
+    {
+        delete obj;
+    }
+
+    int add_pattern(
+        SnortConfig*, const uint8_t* P, unsigned m,
+        bool, bool negative, void* ID, int) override
+    {
+        obj->add(P, m, negative, ID);
+        return 0;
+    }
+
+    int prep_patterns(
+        SnortConfig* sc, MpseBuild build_tree, MpseNegate neg_list) override
+    {
+        return obj->compile(sc, build_tree, neg_list);
+    }
+
+    // there is no state to carry between buffers
+    int _search(
+        const unsigned char* T, int n, MpseMatch match,
+        void* data, int* current_state) override
+    {
+        if ( current_state )
+            *current_state = 0;
+
+        return obj->search(T, n, match, data);
+    }
+
+    int print_info() override
+    {
+        obj->print_info();
+        return 0;
+    }
+
+    int get_pattern_count() override
+    {
+        return obj->get_pattern_count();
+    }
+};
+
+//-------------------------------------------------------------------------
+// api
+//-------------------------------------------------------------------------
+
+static Mpse* lit_ctor(
+    SnortConfig* sc,
+    class Module*,
+    bool use_gc,
+    void (* user_free)(void*),
+    void (* tree_free)(void**),
+    void (* list_free)(void**))
+{
+    return new LiteralMpse(sc, use_gc, user_free, tree_free, list_free);
+}
+
+static void lit_dtor(Mpse* p)
+{
+    delete p;
+}
+
+static void lit_init()
+{
+    LitSearch::init();
+}
+
+static void lit_print()
+{
+    LitSearch::print_summary();
+}
+
+static const MpseApi lit_api =
+{
+    {
+        PT_SEARCH_ENGINE,
+        sizeof(MpseApi),
+        SEAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        "literal",
+        "SIMD prefilter with hashed verification for large literal pattern sets",
+        nullptr,
+        nullptr
+    },
+    false,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    lit_ctor,
+    lit_dtor,
+    lit_init,
+    lit_print,
+};
+
+#ifdef BUILDING_SO
+SO_PUBLIC const BaseApi* snort_plugins[] =
+{
+    &lit_api.base,
+    nullptr
+};
+#else
+const BaseApi* se_literal = &lit_api.base;
+#endif
+
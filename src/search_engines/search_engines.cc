@@ -32,6 +32,7 @@ extern const BaseApi* se_ac_full_q;
 extern const BaseApi* se_ac_sparse;
 extern const BaseApi* se_ac_sparse_bands;
 extern const BaseApi* se_ac_std;
+extern const BaseApi* se_literal;
 
 #ifdef INTEL_SOFT_CPM
 extern const BaseApi* se_intel_cpm;
@@ -46,6 +47,7 @@ const BaseApi* search_engines[] =
     se_ac_sparse,
     se_ac_sparse_bands,
     se_ac_std,
+    se_literal,
 #ifdef INTEL_SOFT_CPM
     se_intel_cpm,
 #endif
@@ -0,0 +1,73 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// nhttp_arena.cc
+
+#include "nhttp_arena.h"
+#include "nhttp_module.h"
+
+void NHttpArena::add_block(uint32_t size)
+{
+    // Grow geometrically so a big transaction only needs a few blocks
+    uint32_t capacity = (blocks != nullptr) ? 2 * blocks->capacity : MIN_BLOCK;
+    if (capacity < size)
+        capacity = size;
+
+    Block* const block = (Block*)new uint64_t[(sizeof(Block) + capacity)/8];
+    block->next = blocks;
+    block->capacity = capacity;
+    blocks = block;
+    used = 0;
+    nhttp_stats.arena_blocks++;
+}
+
+void NHttpArena::release()
+{
+    while (blocks != nullptr)
+    {
+        Block* const block = blocks;
+        blocks = blocks->next;
+        delete[] (uint64_t*)block;
+    }
+    used = 0;
+}
+
+void NHttpArena::reset()
+{
+    if (blocks == nullptr)
+        return;
+
+    nhttp_stats.arena_resets++;
+
+    // A single block is simply rewound. Several are merged into one block big enough for the
+    // whole transaction so the next one like it fits without allocating.
+    if (blocks->next == nullptr)
+    {
+        used = 0;
+        if (blocks->capacity > MAX_KEPT)
+            release();
+        return;
+    }
+
+    uint32_t total = 0;
+    for (Block* block = blocks; block != nullptr; block = block->next)
+        total += block->capacity;
+    release();
+
+    if (total <= MAX_KEPT)
+        add_block(total);
+}
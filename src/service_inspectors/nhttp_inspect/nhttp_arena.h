@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// nhttp_arena.h
+
+#ifndef NHTTP_ARENA_H
+#define NHTTP_ARENA_H
+
+#include <stdint.h>
+#include <new>
+
+//-------------------------------------------------------------------------
+// NHttpArena class
+// Storage management class
+//-------------------------------------------------------------------------
+
+// Bump allocator for everything that lives as long as a transaction: the message sections, their
+// scratch pads and header arrays, and the URI.
+// 1. allocate() returns 64-bit aligned memory and never fails
+// 2. nothing is freed individually; destructors still run but give back no memory
+// 3. reset() makes all of it available again
+// reset() keeps the memory, merged into one block, so the next transaction on the flow
+// usually does not touch the heap at all.
+
+class NHttpArena
+{
+public:
+    NHttpArena() = default;
+    ~NHttpArena() { release(); }
+    NHttpArena(const NHttpArena&) = delete;
+    NHttpArena& operator=(const NHttpArena&) = delete;
+
+    void* allocate(uint32_t size)
+    {
+        size = (size + 7) & ~7;
+        if ((blocks == nullptr) || (size > blocks->capacity - used))
+            add_block(size);
+        uint8_t* const mem = (uint8_t*)(blocks + 1) + used;
+        used += size;
+        return mem;
+    }
+
+    template <typename T> T* create() { return new (allocate(sizeof(T))) T; }
+
+    template <typename T> T* create_array(uint32_t num)
+    {
+        T* const array = (T*)allocate(num * sizeof(T));
+        for (uint32_t k=0; k < num; k++)
+            new (array + k) T;
+        return array;
+    }
+
+    void reset();
+
+private:
+    struct Block
+    {
+        Block* next;
+        uint32_t capacity;
+        uint32_t filler;    // keeps what follows 64-bit aligned
+    };
+
+    static const uint32_t MIN_BLOCK = 4096;
+    static const uint32_t MAX_KEPT = 1 << 18;  // bigger is given back to the heap on reset
+
+    void add_block(uint32_t size);
+    void release();
+
+    Block* blocks = nullptr;  // current block first
+    uint32_t used = 0;        // in the current block
+};
+
+#endif
+
@@ -19,8 +19,81 @@
 
 #include "nhttp_cutter.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NHTTP_X86
+#include <immintrin.h>
+#endif
+
 using namespace NHttpEnums;
 
+// Most octets of a start line, a header block, or chunk options are only of interest to the
+// cutters because they are not CR or LF. find_crlf() returns the position of the next CR or LF
+// at or after start or length if there is none so the state machines can jump straight to it.
+
+static inline uint32_t find_crlf_c(const uint8_t* buffer, uint32_t start, uint32_t length)
+{
+    for (; start < length; start++)
+    {
+        if ((buffer[start] == '\r') || (buffer[start] == '\n'))
+            break;
+    }
+    return start;
+}
+
+#ifdef NHTTP_X86
+__attribute__((target("sse2")))
+static uint32_t find_crlf_sse2(const uint8_t* buffer, uint32_t start, uint32_t length)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    for (; start + 16 <= length; start += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(buffer + start));
+        const unsigned hits = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+        if (hits)
+            return start + __builtin_ctz(hits);
+    }
+    return find_crlf_c(buffer, start, length);
+}
+
+__attribute__((target("avx2")))
+static uint32_t find_crlf_avx2(const uint8_t* buffer, uint32_t start, uint32_t length)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+
+    for (; start + 32 <= length; start += 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(buffer + start));
+        const unsigned hits = _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+        if (hits)
+            return start + __builtin_ctz(hits);
+    }
+    return find_crlf_sse2(buffer, start, length);
+}
+#endif
+
+// Runs shorter than a vector aren't worth the setup
+static const uint32_t MIN_VECTOR = 16;
+
+static inline uint32_t find_crlf(const uint8_t* buffer, uint32_t start, uint32_t length)
+{
+#ifdef NHTTP_X86
+    if (length - start >= MIN_VECTOR)
+    {
+        if (__builtin_cpu_supports("avx2"))
+            return find_crlf_avx2(buffer, start, length);
+
+        if (__builtin_cpu_supports("sse2"))
+            return find_crlf_sse2(buffer, start, length);
+    }
+#endif
+    return find_crlf_c(buffer, start, length);
+}
+
 ScanResult NHttpStartCutter::cut(const uint8_t* buffer, uint32_t length,
     NHttpInfractions& infractions, NHttpEventGen& events, uint32_t, uint32_t)
 {
@@ -91,6 +164,11 @@ ScanResult NHttpStartCutter::cut(const uint8_t* buffer, uint32_t length,
         {
             num_crlf = 1;
         }
+        else if (validated)
+        {
+            // Nothing else in the start line matters to us
+            k = find_crlf(buffer, k+1, length) - 1;
+        }
     }
     octets_seen += length;
     return SCAN_NOTFOUND;
@@ -166,6 +244,8 @@ ScanResult NHttpHeaderCutter::cut(const uint8_t* buffer, uint32_t length,
         {
             num_crlf = 0;
             first_lf = 0;
+            // The rest of the header line does not change that
+            k = find_crlf(buffer, k+1, length) - 1;
         }
     }
     octets_seen += length;
@@ -284,6 +364,11 @@ ScanResult NHttpChunkCutter::cut(const uint8_t* buffer, uint32_t length,
             }
             break;
         case CHUNK_OPTIONS:
+            // Chunk options are ignored up to the end of the line
+            if ((k = find_crlf(buffer, k, length)) == length)
+            {
+                break;
+            }
             if (buffer[k] == '\r')
             {
                 curr_state = CHUNK_HCRLF;
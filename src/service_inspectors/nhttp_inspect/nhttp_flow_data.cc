@@ -59,6 +59,7 @@ NHttpFlowData::~NHttpFlowData()
     }
 
     delete_pipeline();
+    delete spare_transaction;
 }
 
 void NHttpFlowData::half_reset(SourceId source_id)
@@ -111,6 +111,9 @@ private:
     bool pipeline_overflow = false;
     bool pipeline_underflow = false;
 
+    // A finished transaction kept for the next one so its arenas are reused
+    NHttpTransaction* spare_transaction = nullptr;
+
     bool add_to_pipeline(NHttpTransaction* latest);
     NHttpTransaction* take_from_pipeline();
     void delete_pipeline();
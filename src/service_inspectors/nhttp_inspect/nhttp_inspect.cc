@@ -93,34 +93,50 @@ bool NHttpInspect::process(const uint8_t* data, const uint16_t dsize, Flow* cons
         NHttpFlowData::nhttp_flow_id);
     assert(session_data != nullptr);
 
-    switch (session_data->section_type[source_id])
+    const SectionType section_type = session_data->section_type[source_id];
+    if ((section_type < SEC_REQUEST) || (section_type > SEC_TRAILER))
+    {
+        assert(0);
+        if (buf_owner)
+        {
+            delete[] data;
+        }
+        return false;
+    }
+
+    // The section is allocated from its transaction so that must be settled first
+    NHttpTransaction* const transaction = NHttpTransaction::attach_my_transaction(session_data,
+        source_id);
+    NHttpArena& arena = transaction->get_arena(section_type);
+
+    switch (section_type)
     {
     case SEC_REQUEST:
-        latest_section = new NHttpMsgRequest(data, dsize, session_data, source_id, buf_owner,
-            flow);
+        latest_section = new (arena) NHttpMsgRequest(data, dsize, session_data, source_id,
+            buf_owner, flow);
         break;
     case SEC_STATUS:
-        latest_section = new NHttpMsgStatus(data, dsize, session_data, source_id, buf_owner, flow);
+        latest_section = new (arena) NHttpMsgStatus(data, dsize, session_data, source_id,
+            buf_owner, flow);
         break;
     case SEC_HEADER:
-        latest_section = new NHttpMsgHeader(data, dsize, session_data, source_id, buf_owner, flow);
+        latest_section = new (arena) NHttpMsgHeader(data, dsize, session_data, source_id,
+            buf_owner, flow);
         break;
     case SEC_BODY:
-        latest_section = new NHttpMsgBody(data, dsize, session_data, source_id, buf_owner, flow);
+        latest_section = new (arena) NHttpMsgBody(data, dsize, session_data, source_id,
+            buf_owner, flow);
         break;
     case SEC_CHUNK:
-        latest_section = new NHttpMsgChunk(data, dsize, session_data, source_id, buf_owner, flow);
+        latest_section = new (arena) NHttpMsgChunk(data, dsize, session_data, source_id,
+            buf_owner, flow);
         break;
     case SEC_TRAILER:
-        latest_section = new NHttpMsgTrailer(data, dsize, session_data, source_id, buf_owner,
-            flow);
+        latest_section = new (arena) NHttpMsgTrailer(data, dsize, session_data, source_id,
+            buf_owner, flow);
         break;
     default:
         assert(0);
-        if (buf_owner)
-        {
-            delete[] data;
-        }
         return false;
     }
 
@@ -169,14 +185,13 @@ void NHttpInspect::clear(NHttpFlowData* session_data, SourceId source_id)
     // If current transaction is complete then we are done with it and should reclaim the space
     if ((source_id == SRC_SERVER) && (session_data->type_expected[SRC_SERVER] == SEC_STATUS))
     {
-        delete session_data->transaction[SRC_SERVER];
+        NHttpTransaction::discard(session_data, session_data->transaction[SRC_SERVER]);
         session_data->transaction[SRC_SERVER] = nullptr;
     }
     else
     {
         // Get rid of most recent body section if present
-        delete session_data->transaction[source_id]->get_body();
-        session_data->transaction[source_id]->set_body(nullptr);
+        session_data->transaction[source_id]->delete_body();
     }
 }
 
@@ -22,6 +22,19 @@
 
 #include "nhttp_module.h"
 
+THREAD_LOCAL NHttpStats nhttp_stats;
+
+// Allocation counters: a transaction that is recycled and fits in its arenas costs no heap
+// allocations, so arena blocks / transactions is the heap traffic per transaction.
+const PegInfo NHttpModule::peg_names[] =
+{
+    { "transactions", "transactions started" },
+    { "recycled transactions", "transactions that reused the arenas of a finished one" },
+    { "arena blocks", "heap blocks allocated by transaction arenas" },
+    { "arena resets", "arenas rewound for reuse" },
+    { nullptr, nullptr }
+};
+
 const Parameter NHttpModule::nhttp_params[] =
 {
     { "test_input", Parameter::PT_BOOL, nullptr, "false", "read HTTP messages from text file" },
@@ -21,12 +21,23 @@
 #define NHTTP_MODULE_H
 
 #include "framework/module.h"
+#include "main/thread.h"
 
 #include "nhttp_enum.h"
 
 #define NHTTP_NAME "new_http_inspect"
 #define NHTTP_HELP "new HTTP inspector"
 
+struct NHttpStats
+{
+    PegCount transactions;
+    PegCount recycled_transactions;
+    PegCount arena_blocks;
+    PegCount arena_resets;
+};
+
+extern THREAD_LOCAL NHttpStats nhttp_stats;
+
 class NHttpModule : public Module
 {
 public:
@@ -38,9 +49,12 @@ public:
     const RuleMap* get_rules() const override { return nhttp_events; }
     bool get_test_input() const { return test_input; }
     bool get_test_output() const { return test_output; }
+    const PegInfo* get_pegs() const override { return peg_names; }
+    PegCount* get_counts() const override { return (PegCount*)&nhttp_stats; }
 
 private:
     static const Parameter nhttp_params[];
+    static const PegInfo peg_names[];
     static const RuleMap nhttp_events[];
     bool test_input = false;
     bool test_output = false;
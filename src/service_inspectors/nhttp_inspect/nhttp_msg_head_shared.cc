@@ -27,21 +27,6 @@
 
 using namespace NHttpEnums;
 
-NHttpMsgHeadShared::~NHttpMsgHeadShared()
-{
-    delete[] header_line;
-    delete[] header_name;
-    delete[] header_name_id;
-    delete[] header_value;
-    NormalizedHeader* list_ptr = norm_heads;
-    while (list_ptr != nullptr)
-    {
-        NormalizedHeader* temp_ptr = list_ptr;
-        list_ptr = list_ptr->next;
-        delete temp_ptr;
-    }
-}
-
 // All the header processing that is done for every message (i.e. not just-in-time) is done here.
 void NHttpMsgHeadShared::analyze()
 {
@@ -63,7 +48,7 @@ void NHttpMsgHeadShared::analyze()
             {
                 headers_present[header_name_id[j]] = true;
                 NormalizedHeader* tmp_ptr = norm_heads;
-                norm_heads = new NormalizedHeader;
+                norm_heads = arena.create<NormalizedHeader>();
                 norm_heads->next = tmp_ptr;
                 norm_heads->id = header_name_id[j];
                 norm_heads->count = 1;
@@ -80,7 +65,7 @@ void NHttpMsgHeadShared::parse_header_block()
     int num_seps;
     // session_data->num_head_lines is computed without consideration of wrapping and may overstate
     // actual number of headers. Rely on num_headers which is calculated correctly.
-    header_line = new Field[session_data->num_head_lines[source_id]];
+    header_line = arena.create_array<Field>(session_data->num_head_lines[source_id]);
     while (bytes_used < msg_text.length)
     {
         assert(num_headers < session_data->num_head_lines[source_id]);
@@ -142,9 +127,9 @@ uint32_t NHttpMsgHeadShared::find_header_end(const uint8_t* buffer, int32_t leng
 // Divide header field lines into field name and field value
 void NHttpMsgHeadShared::parse_header_lines()
 {
-    header_name = new Field[num_headers];
-    header_value = new Field[num_headers];
-    header_name_id = new HeaderId[num_headers];
+    header_name = arena.create_array<Field>(num_headers);
+    header_value = arena.create_array<Field>(num_headers);
+    header_name_id = arena.create_array<HeaderId>(num_headers);
 
     int colon;
     for (int k=0; k < num_headers; k++)
@@ -171,18 +156,9 @@ void NHttpMsgHeadShared::parse_header_lines()
 
 void NHttpMsgHeadShared::derive_header_name_id(int index)
 {
-    // Normalize header field name to lower case for matching purposes
-    uint8_t* lower_name;
-    if ((lower_name = scratch_pad.request(header_name[index].length)) == nullptr)
-    {
-        infractions += INF_NO_SCRATCH;
-        header_name_id[index] = HEAD__INSUFMEMORY;
-        return;
-    }
-    norm_to_lower(header_name[index].start, header_name[index].length, lower_name, infractions,
-        events, nullptr);
-    header_name_id[index] = (HeaderId)str_to_code(lower_name, header_name[index].length,
-        header_list);
+    // Header field names are matched without regard to case
+    header_name_id[index] = (HeaderId)str_to_code(header_name[index].start,
+        header_name[index].length, header_map);
 }
 
 NHttpMsgHeadShared::NormalizedHeader* NHttpMsgHeadShared::get_header_node(HeaderId header_id) const
@@ -34,8 +34,6 @@
 class NHttpMsgHeadShared : public NHttpMsgSection
 {
 public:
-    ~NHttpMsgHeadShared();
-
     void analyze() override;
 
     int32_t get_num_headers() const { return num_headers; }
@@ -67,6 +65,8 @@ protected:
     // Tables of header field names and header value names
     static const StrCode header_list[];
     static const StrCode trans_code_list[];
+    static const StrCodeMap header_map;
+    static const StrCodeMap trans_code_map;
 
     void parse_header_block();
     uint32_t find_header_end(const uint8_t* buffer, int32_t length, int& num_seps);
@@ -65,7 +65,7 @@ void NHttpMsgRequest::parse_start_line()
 
     method.start = start_line.start;
     method.length = first_space;
-    method_id = (MethodId)str_to_code(method.start, method.length, method_list);
+    method_id = (MethodId)str_to_code(method.start, method.length, method_map);
 
     version.start = start_line.start + (start_line.length - 8);
     version.length = 8;
@@ -73,8 +73,8 @@ void NHttpMsgRequest::parse_start_line()
 
     if (first_end < last_begin)
     {
-        uri = new NHttpUri(start_line.start + first_end + 1, last_begin - first_end - 1,
-            method_id, infractions, events);
+        uri = new (arena) NHttpUri(start_line.start + first_end + 1,
+            last_begin - first_end - 1, method_id, infractions, events, arena);
     }
     else
     {
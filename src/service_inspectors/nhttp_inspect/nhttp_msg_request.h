@@ -45,6 +45,7 @@ public:
 
 private:
     static const StrCode method_list[];
+    static const StrCodeMap method_map;
 
     void parse_start_line() override;
 
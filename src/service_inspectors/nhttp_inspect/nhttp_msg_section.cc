@@ -39,9 +39,10 @@ NHttpMsgSection::NHttpMsgSection(const uint8_t* buffer, const uint16_t buf_size,
     session_data(session_data_),
     source_id(source_id_),
     flow(flow_),
-    transaction(NHttpTransaction::attach_my_transaction(session_data, source_id)),
+    transaction(session_data->transaction[source_id]),
     tcp_close(session_data->tcp_close[source_id]),
-    scratch_pad(2*buf_size+500),
+    arena(transaction->get_arena(session_data->section_type[source_id])),
+    scratch_pad(2*buf_size+500, arena),
     infractions(session_data->infractions[source_id]),
     events(session_data->events[source_id]),
     version_id(session_data->version_id[source_id]),
@@ -23,6 +23,7 @@
 #include "stream/stream_api.h"
 #include "detection/detection_util.h"
 
+#include "nhttp_arena.h"
 #include "nhttp_scratch_pad.h"
 #include "nhttp_field.h"
 #include "nhttp_flow_data.h"
@@ -38,6 +39,12 @@ class NHttpMsgSection
 public:
     virtual ~NHttpMsgSection() { if (delete_msg_on_destruct) delete[] msg_text.start; }
 
+    // Sections live in their transaction's arena. Deleting one runs the destructor and the arena
+    // gets the memory back when it is reset.
+    static void* operator new(size_t size, NHttpArena& arena) { return arena.allocate(size); }
+    static void operator delete(void*) { }
+    static void operator delete(void*, NHttpArena&) { }
+
     // Minimum necessary processing for every message
     virtual void analyze() = 0;
 
@@ -72,6 +79,7 @@ protected:
     Flow* const flow;
     NHttpTransaction* transaction;
     const bool tcp_close;
+    NHttpArena& arena;
     ScratchPad scratch_pad;
 
     NHttpInfractions infractions;
@@ -71,13 +71,15 @@ int32_t norm_to_lower(const uint8_t* in_buf, int32_t in_length, uint8_t* out_buf
 int32_t norm_str_code(const uint8_t* in_buf, int32_t in_length, uint8_t* out_buf,
     NHttpInfractions&, NHttpEventGen&, const void* table)
 {
-    ((int64_t*)out_buf)[0] = str_to_code(in_buf, in_length, (const StrCode*)table);
+    const StrCodeMap& map = *(const StrCodeMap*)table;
+    ((int64_t*)out_buf)[0] = str_to_code(in_buf, in_length, map);
     return sizeof(int64_t);
 }
 
 int32_t norm_seq_str_code(const uint8_t* in_buf, int32_t in_length, uint8_t* out_buf,
     NHttpInfractions&, NHttpEventGen&, const void* table)
 {
+    const StrCodeMap& map = *(const StrCodeMap*)table;
     int32_t num_codes = 0;
     const uint8_t* start = in_buf;
     while (true)
@@ -88,7 +90,7 @@ int32_t norm_seq_str_code(const uint8_t* in_buf, int32_t in_length, uint8_t* out
         if (length == 0)
             ((uint32_t*)out_buf)[num_codes++] = STAT_EMPTYSTRING;
         else
-            ((int64_t*)out_buf)[num_codes++] = str_to_code(start, length, (const StrCode*)table);
+            ((int64_t*)out_buf)[num_codes++] = str_to_code(start, length, map);
         if (start + length >= in_buf + in_length)
             break;
         start += length + 1;
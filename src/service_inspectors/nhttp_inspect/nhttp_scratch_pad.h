@@ -20,6 +20,8 @@
 #ifndef NHTTP_SCRATCH_PAD_H
 #define NHTTP_SCRATCH_PAD_H
 
+#include "nhttp_arena.h"
+
 //-------------------------------------------------------------------------
 // ScratchPad class
 // Storage management class
@@ -31,12 +33,13 @@
 // 2. use what you need
 // 3. commit() what you actually used if you want to keep it
 // Anything you do not commit will be reused by the next request.
+// The buffer belongs to the arena it came from and goes away when that is reset.
 
 class ScratchPad
 {
 public:
-    ScratchPad(uint32_t _capacity) : capacity(_capacity), buffer(new uint64_t[_capacity/8+1]) { }
-    ~ScratchPad() { delete[] buffer; }
+    ScratchPad(uint32_t _capacity, NHttpArena& arena) : capacity(_capacity),
+        buffer((uint64_t*)arena.allocate(8*(_capacity/8+1))) { }
     uint8_t* request(uint32_t needed) const
     {
         return (needed <= capacity-used) ?
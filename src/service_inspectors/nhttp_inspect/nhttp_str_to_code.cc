@@ -18,21 +18,88 @@
 // nhttp_str_to_code.cc author Tom Peters <thopeter@cisco.com>
 
 #include <string.h>
+#include <assert.h>
 
 #include "nhttp_enum.h"
 #include "nhttp_str_to_code.h"
 
-// Need to replace this simple algorithm for better performance FIXIT-P
-int32_t str_to_code(const uint8_t* text, const int32_t text_len, const StrCode table[])
+static inline uint8_t fold(uint8_t c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? c + ('a' - 'A') : c;
+}
+
+StrCodeMap::StrCodeMap(const StrCode table[], bool fold_case_) : fold_case(fold_case_)
 {
     for (int32_t k=0; table[k].name != nullptr; k++)
     {
-        if ((text_len == (int)strlen(table[k].name)) && (memcmp(text, table[k].name, text_len) ==
-            0))
+        const int32_t length = strlen(table[k].name);
+        entries.push_back({ table[k].code, length, table[k].name });
+        if (length > max_length)
+            max_length = length;
+    }
+    assert(entries.size() < 256);
+
+    // At least twice as many slots as names, more if no seed separates them
+    unsigned bits = 1;
+    while ((1u << bits) < 2 * entries.size())
+        bits++;
+
+    while (true)
+    {
+        shift = 32 - bits;
+        for (seed = 1; seed <= 4096; seed++)
         {
-            return table[k].code;
+            slots.assign(1u << bits, 0);
+            unsigned k;
+            for (k=0; k < entries.size(); k++)
+            {
+                const uint32_t slot = get_slot(seed, (const uint8_t*)entries[k].name,
+                    entries[k].length);
+                if (slots[slot] != 0)
+                    break;
+                slots[slot] = k + 1;
+            }
+            if (k == entries.size())
+                return;
         }
+        bits++;
+    }
+}
+
+uint32_t StrCodeMap::get_slot(uint32_t seed_, const uint8_t* text, int32_t text_len) const
+{
+    uint32_t hash = seed_ ^ text_len;
+    for (int32_t k=0; k < text_len; k++)
+        hash = (hash ^ (fold_case ? fold(text[k]) : text[k])) * 16777619;
+    return (hash * 2654435761u) >> shift;
+}
+
+int32_t StrCodeMap::find(const uint8_t* text, int32_t text_len) const
+{
+    if ((text_len <= 0) || (text_len > max_length))
+        return NHttpEnums::STAT_OTHER;
+
+    const uint8_t index = slots[get_slot(seed, text, text_len)];
+    if (index == 0)
+        return NHttpEnums::STAT_OTHER;
+
+    const Entry& entry = entries[index-1];
+    if (entry.length != text_len)
+        return NHttpEnums::STAT_OTHER;
+
+    if (!fold_case)
+        return (memcmp(text, entry.name, text_len) == 0) ? entry.code : NHttpEnums::STAT_OTHER;
+
+    for (int32_t k=0; k < text_len; k++)
+    {
+        if (fold(text[k]) != (uint8_t)entry.name[k])
+            return NHttpEnums::STAT_OTHER;
     }
-    return NHttpEnums::STAT_OTHER;
+    return entry.code;
+}
+
+int32_t str_to_code(const uint8_t* text, const int32_t text_len, const StrCodeMap& map)
+{
+    return map.find(text, text_len);
 }
 
@@ -20,13 +20,45 @@
 #ifndef NHTTP_STR_TO_CODE_H
 #define NHTTP_STR_TO_CODE_H
 
+#include <stdint.h>
+#include <vector>
+
 struct StrCode
 {
     int32_t code;
     const char* name;
 };
 
-int32_t str_to_code(const uint8_t* text, const int32_t text_len, const StrCode table[]);
+// Perfect hash index over a StrCode table. The table is still where the strings are defined; the
+// map is built from it once during static initialization by trying hash seeds until no two names
+// share a slot, so a lookup hashes the text once and compares against at most one name.
+// With fold_case the text is matched without regard to case and the names in the table must be
+// lower case.
+class StrCodeMap
+{
+public:
+    StrCodeMap(const StrCode table[], bool fold_case);
+    int32_t find(const uint8_t* text, int32_t text_len) const;
+
+private:
+    struct Entry
+    {
+        int32_t code;
+        int32_t length;
+        const char* name;
+    };
+
+    uint32_t get_slot(uint32_t seed_, const uint8_t* text, int32_t text_len) const;
+
+    std::vector<Entry> entries;
+    std::vector<uint8_t> slots;   // entry index + 1, 0 is empty
+    uint32_t seed = 0;
+    unsigned shift = 0;
+    int32_t max_length = 0;
+    const bool fold_case;
+};
+
+int32_t str_to_code(const uint8_t* text, const int32_t text_len, const StrCodeMap& map);
 
 #endif
 
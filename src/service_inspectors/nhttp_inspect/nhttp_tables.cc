@@ -87,6 +87,9 @@ const StrCode NHttpMsgRequest::method_list[] =
     { 0,                       nullptr }
 };
 
+// Methods are case sensitive
+const StrCodeMap NHttpMsgRequest::method_map(method_list, false);
+
 const StrCode NHttpUri::scheme_list[] =
 {
     { SCH_HTTP,                "http" },
@@ -97,6 +100,8 @@ const StrCode NHttpUri::scheme_list[] =
     { 0,                       nullptr }
 };
 
+const StrCodeMap NHttpUri::scheme_map(scheme_list, true);
+
 const StrCode NHttpMsgHeadShared::header_list[] =
 {
     { HEAD_CACHE_CONTROL,        "cache-control" },
@@ -153,6 +158,8 @@ const StrCode NHttpMsgHeadShared::header_list[] =
     { 0,                         nullptr }
 };
 
+const StrCodeMap NHttpMsgHeadShared::header_map(header_list, true);
+
 const StrCode NHttpMsgHeadShared::trans_code_list[] =
 {
     { TRANSCODE_CHUNKED,         "chunked" },
@@ -163,6 +170,8 @@ const StrCode NHttpMsgHeadShared::trans_code_list[] =
     { 0,                         nullptr }
 };
 
+const StrCodeMap NHttpMsgHeadShared::trans_code_map(trans_code_list, true);
+
 const HeaderNormalizer NHttpMsgHeadShared::NORMALIZER_NIL
 { NORM_NULL, false, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
 
@@ -177,7 +186,7 @@ const HeaderNormalizer NHttpMsgHeadShared::NORMALIZER_DECIMAL
 
 const HeaderNormalizer NHttpMsgHeadShared::NORMALIZER_TRANSCODE
 { NORM_ENUM64, true, norm_remove_lws, nullptr, norm_to_lower, nullptr, norm_seq_str_code,
-  NHttpMsgHeadShared::trans_code_list };
+  &NHttpMsgHeadShared::trans_code_map };
 
 #if defined(__clang__)
 // Designated initializers are not supported in C++11. However we're going to play compilation
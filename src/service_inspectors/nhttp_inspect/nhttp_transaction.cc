@@ -26,10 +26,18 @@
 #include "nhttp_msg_header.h"
 #include "nhttp_msg_trailer.h"
 #include "nhttp_msg_body.h"
+#include "nhttp_module.h"
 
 using namespace NHttpEnums;
 
 NHttpTransaction::~NHttpTransaction()
+{
+    delete_sections();
+}
+
+// Sections are allocated from the arenas so delete only runs their destructors. The memory comes
+// back when the arenas are reset.
+void NHttpTransaction::delete_sections()
 {
     delete request;
     delete status;
@@ -38,6 +46,44 @@ NHttpTransaction::~NHttpTransaction()
     delete trailer[0];
     delete trailer[1];
     delete latest_body;
+    request = nullptr;
+    status = nullptr;
+    header[0] = header[1] = nullptr;
+    trailer[0] = trailer[1] = nullptr;
+    latest_body = nullptr;
+}
+
+void NHttpTransaction::delete_body()
+{
+    delete latest_body;
+    latest_body = nullptr;
+    body_arena.reset();
+}
+
+NHttpTransaction* NHttpTransaction::create(NHttpFlowData* session_data)
+{
+    nhttp_stats.transactions++;
+    NHttpTransaction* const transaction = session_data->spare_transaction;
+    if (transaction == nullptr)
+    {
+        return new NHttpTransaction;
+    }
+    nhttp_stats.recycled_transactions++;
+    session_data->spare_transaction = nullptr;
+    return transaction;
+}
+
+void NHttpTransaction::discard(NHttpFlowData* session_data, NHttpTransaction* transaction)
+{
+    if ((transaction == nullptr) || (session_data->spare_transaction != nullptr))
+    {
+        delete transaction;
+        return;
+    }
+    transaction->delete_sections();
+    transaction->arena.reset();
+    transaction->body_arena.reset();
+    session_data->spare_transaction = transaction;
 }
 
 NHttpTransaction* NHttpTransaction::attach_my_transaction(NHttpFlowData* session_data, SourceId
@@ -60,17 +106,17 @@ NHttpTransaction* NHttpTransaction::attach_my_transaction(NHttpFlowData* session
         {
             if ((session_data->pipeline_overflow) || (session_data->pipeline_underflow))
             {
-                delete session_data->transaction[SRC_CLIENT];
+                discard(session_data, session_data->transaction[SRC_CLIENT]);
             }
             else if (!session_data->add_to_pipeline(session_data->transaction[SRC_CLIENT]))
             {
                 // The pipeline is full and just overflowed.
                 session_data->infractions[source_id] += INF_PARTIAL_START;
                 session_data->events[source_id].create_event(EVENT_PIPELINE_MAX);
-                delete session_data->transaction[SRC_CLIENT];
+                discard(session_data, session_data->transaction[SRC_CLIENT]);
             }
         }
-        session_data->transaction[SRC_CLIENT] = new NHttpTransaction;
+        session_data->transaction[SRC_CLIENT] = create(session_data);
     }
     // Status section: delete the current transaction and get a new one from the pipeline. If the
     // pipeline is empty check for a request-side transaction that just finished and take it. If
@@ -78,10 +124,10 @@ NHttpTransaction* NHttpTransaction::attach_my_transaction(NHttpFlowData* session
     // specifically for the response side.
     else if (session_data->section_type[source_id] == SEC_STATUS)
     {
-        delete session_data->transaction[SRC_SERVER];
+        discard(session_data, session_data->transaction[SRC_SERVER]);
         if (session_data->pipeline_underflow)
         {
-            session_data->transaction[SRC_SERVER] = new NHttpTransaction;
+            session_data->transaction[SRC_SERVER] = create(session_data);
         }
         else if ((session_data->transaction[SRC_SERVER] = session_data->take_from_pipeline()) ==
             nullptr)
@@ -95,7 +141,7 @@ NHttpTransaction* NHttpTransaction::attach_my_transaction(NHttpFlowData* session
             else
             {
                 session_data->pipeline_underflow = true;
-                session_data->transaction[SRC_SERVER] = new NHttpTransaction;
+                session_data->transaction[SRC_SERVER] = create(session_data);
             }
         }
     }
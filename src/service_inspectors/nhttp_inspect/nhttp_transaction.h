@@ -21,6 +21,7 @@
 #define TRANSACTION_H
 
 #include "nhttp_enum.h"
+#include "nhttp_arena.h"
 #include "nhttp_flow_data.h"
 
 class NHttpMsgRequest;
@@ -38,6 +39,17 @@ public:
         NHttpEnums::SourceId source_id);
     ~NHttpTransaction();
 
+    // Transactions are recycled through the flow so their arenas keep their memory
+    static NHttpTransaction* create(NHttpFlowData* session_data);
+    static void discard(NHttpFlowData* session_data, NHttpTransaction* transaction);
+
+    // Body sections come and go one at a time and have an arena of their own
+    NHttpArena& get_arena(NHttpEnums::SectionType section_type)
+    {
+        return ((section_type == NHttpEnums::SEC_BODY) || (section_type == NHttpEnums::SEC_CHUNK))
+            ? body_arena : arena;
+    }
+
     NHttpMsgRequest* get_request() const { return request; }
     void set_request(NHttpMsgRequest* request_) { request = request_; }
 
@@ -55,6 +67,7 @@ public:
 
     NHttpMsgBody* get_body() const { return latest_body; }
     void set_body(NHttpMsgBody* latest_body_) { latest_body = latest_body_; }
+    void delete_body();
 
     // Convenience method
     NHttpMsgHeadShared* get_latest_header(NHttpEnums::SourceId source_id)
@@ -65,12 +78,17 @@ public:
 
 private:
     NHttpTransaction() = default;
+    void delete_sections();
 
     NHttpMsgRequest* request = nullptr;
     NHttpMsgStatus* status = nullptr;
     NHttpMsgHeader* header[2] = { nullptr, nullptr };
     NHttpMsgTrailer* trailer[2] = { nullptr, nullptr };
     NHttpMsgBody* latest_body = nullptr;
+
+    // Declared last so the sections are gone before their memory
+    NHttpArena arena;
+    NHttpArena body_arena;
 };
 
 #endif
@@ -104,16 +104,8 @@ SchemeId NHttpUri::get_scheme_id()
         return scheme_id;
     }
 
-    // Normalize scheme name to lower case for matching purposes
-    uint8_t* lower_scheme;
-    if ((lower_scheme = scratch_pad.request(scheme.length)) == nullptr)
-    {
-        infractions += INF_NO_SCRATCH;
-        scheme_id = SCH__INSUFMEMORY;
-        return scheme_id;
-    }
-    norm_to_lower(scheme.start, scheme.length, lower_scheme, infractions, events, nullptr);
-    scheme_id = (SchemeId)str_to_code(lower_scheme, scheme.length, scheme_list);
+    // Scheme names are matched without regard to case
+    scheme_id = (SchemeId)str_to_code(scheme.start, scheme.length, scheme_map);
     return scheme_id;
 }
 
@@ -35,9 +35,15 @@ class NHttpUri
 {
 public:
     NHttpUri(const uint8_t* start, int32_t length, NHttpEnums::MethodId method,
-        NHttpInfractions& infractions_, NHttpEventGen& events_) :
+        NHttpInfractions& infractions_, NHttpEventGen& events_, NHttpArena& arena) :
         uri(length, start), method_id(method), infractions(infractions_), events(events_),
-        scratch_pad(2*length+200) { }
+        scratch_pad(2*length+200, arena) { }
+
+    // Lives in the request's arena like the request itself
+    static void* operator new(size_t size, NHttpArena& arena) { return arena.allocate(size); }
+    static void operator delete(void*) { }
+    static void operator delete(void*, NHttpArena&) { }
+
     const Field& get_uri() const { return uri; }
     NHttpEnums::UriType get_uri_type() { parse_uri(); return uri_type; }
     const Field& get_scheme() { parse_uri(); return scheme; }
@@ -59,6 +65,7 @@ public:
 
 private:
     static const StrCode scheme_list[];
+    static const StrCodeMap scheme_map;
     static const int MAX_PORT_VALUE = 65535;
 
     const Field uri;
@@ -0,0 +1,169 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// sf_iplpm.cc
+
+#include "sf_iplpm.h"
+
+#include <string.h>
+#include <utility>
+
+#define LPM_POS 0x01
+#define LPM_NEG 0x02
+
+// the build trie is just 256 entries of marks and child indices per node;
+// the roots are 0 (IPv4) and 1 (IPv6) so 0 also means no child
+struct LpmBuildNode
+{
+    uint8_t marks[256];
+    uint32_t child[256];
+};
+
+using LpmBuild = std::vector<LpmBuildNode>;
+
+static void lpm_insert(LpmBuild& t, const sfip_t* ip, unsigned bits, uint8_t mark)
+{
+    unsigned max = ip->is_ip6() ? 128 : 32;
+    unsigned n = ip->is_ip6() ? 1 : 0;
+    unsigned depth = 0;
+
+    if ( bits > max )
+        bits = max;
+
+    // descend while the prefix extends past this byte
+    while ( bits > 8 * (depth + 1) )
+    {
+        uint8_t b = ip->ip8[depth++];
+
+        if ( !t[n].child[b] )
+        {
+            t[n].child[b] = t.size();
+            t.push_back(LpmBuildNode());
+        }
+        n = t[n].child[b];
+    }
+
+    // and mark the byte values it covers here
+    unsigned rem = bits - 8 * depth;
+    unsigned span = 1 << (8 - rem);
+    unsigned first = rem ? (ip->ip8[depth] & ~(span - 1) & 0xFF) : 0;
+
+    for ( unsigned i = first; i < first + span; ++i )
+        t[n].marks[i] |= mark;
+}
+
+static void lpm_insert_all(LpmBuild& t, uint8_t mark)
+{
+    sfip_t ip;
+    memset(&ip, 0, sizeof(ip));
+
+    ip.family = AF_INET;
+    lpm_insert(t, &ip, 0, mark);
+
+    ip.family = AF_INET6;
+    lpm_insert(t, &ip, 0, mark);
+}
+
+static void lpm_insert_list(LpmBuild& t, const sfip_node_t* node, uint8_t mark)
+{
+    for ( ; node; node = node->next )
+    {
+        // an any (or the zeroed address) matches both families
+        if ( !node->ip || (node->flags & SFIP_ANY) || !sfip_is_set(node->ip) )
+            lpm_insert_all(t, mark);
+
+        else
+            lpm_insert(t, node->ip, sfip_bits(node->ip), mark);
+    }
+}
+
+// breadth first so that the children of each node are contiguous.  marks
+// are pushed down to the leaves as we go.
+static void lpm_emit(const LpmBuild& t, std::vector<LpmNode>& nodes)
+{
+    std::vector<std::pair<uint32_t, uint8_t>> queue;  // build node, inherited marks
+
+    queue.push_back(std::make_pair(0, 0));
+    queue.push_back(std::make_pair(1, 0));
+
+    for ( size_t i = 0; i < queue.size(); ++i )
+    {
+        const LpmBuildNode& bn = t[queue[i].first];
+        uint8_t up = queue[i].second;
+
+        LpmNode n;
+        memset(&n, 0, sizeof(n));
+
+        n.base = queue.size();
+        unsigned children = 0;
+
+        for ( unsigned w = 0; w < 4; ++w )
+        {
+            n.rank[w] = children;
+
+            for ( unsigned j = 0; j < 64; ++j )
+            {
+                unsigned v = w * 64 + j;
+                uint8_t marks = up | bn.marks[v];
+
+                if ( bn.child[v] )
+                {
+                    n.child[w] |= 1ull << j;
+                    queue.push_back(std::make_pair(bn.child[v], marks));
+                    ++children;
+                }
+                else if ( (marks & LPM_POS) && !(marks & LPM_NEG) )
+                    n.in[w] |= 1ull << j;
+            }
+        }
+        nodes.push_back(n);
+    }
+}
+
+sfip_lpm_t* sfip_lpm_new(const sfip_node_t* head, const sfip_node_t* neg_head)
+{
+    LpmBuild t(2);
+
+    // no positive entries means everything not negated
+    if ( head )
+        lpm_insert_list(t, head, LPM_POS);
+    else
+        lpm_insert_all(t, LPM_POS);
+
+    lpm_insert_list(t, neg_head, LPM_NEG);
+
+    sfip_lpm_t* lpm = new sfip_lpm_t;
+    lpm->refs = 1;
+    lpm_emit(t, lpm->nodes);
+
+    return lpm;
+}
+
+sfip_lpm_t* sfip_lpm_ref(sfip_lpm_t* lpm)
+{
+    if ( lpm )
+        lpm->refs++;
+
+    return lpm;
+}
+
+void sfip_lpm_free(sfip_lpm_t* lpm)
+{
+    if ( lpm && !--lpm->refs )
+        delete lpm;
+}
+
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// sf_iplpm.h
+
+#ifndef SF_IPLPM_H
+#define SF_IPLPM_H
+
+// sfip_lpm_t is the compiled form of an ip variable's lists.  it is a
+// multibit trie with a stride of one address byte so an IPv4 lookup takes
+// at most 4 steps and an IPv6 lookup at most 16, regardless of the number
+// of addresses in the variable.
+//
+// the positive and negated lists are folded in at build time: each
+// prefix marks the entries it covers and the marks are pushed down to
+// the leaves, which hold the final verdict (covered by a positive entry
+// and not by a negated one).  so a node just needs a bit per byte value
+// for the verdict and another for "keep going"; the children of a node
+// are contiguous and indexed by the rank of the byte in the child bits
+// (poptrie style) which keeps a node at 72 bytes.
+//
+// tries are built at config load and are read only afterwards.  they are
+// reference counted so that copies and aliases of a variable share one.
+
+#include <stdint.h>
+#include <vector>
+
+#include "sfip/sf_ipvar.h"
+
+struct LpmNode
+{
+    uint64_t in[4];     // verdict by byte where there is no child
+    uint64_t child[4];  // bytes with a child
+    uint32_t base;      // index of the first child
+    uint8_t rank[4];    // children before each word of child bits
+};
+
+struct sfip_lpm_t
+{
+    std::vector<LpmNode> nodes;  // [0] is the IPv4 root, [1] is IPv6
+    unsigned refs;
+};
+
+// builds the trie for the given lists; never returns null
+sfip_lpm_t* sfip_lpm_new(const sfip_node_t* head, const sfip_node_t* neg_head);
+
+sfip_lpm_t* sfip_lpm_ref(sfip_lpm_t*);
+void sfip_lpm_free(sfip_lpm_t*);  // drops a reference
+
+inline bool sfip_lpm_lookup(const sfip_lpm_t* lpm, const sfip_t* ip)
+{
+    const LpmNode* nodes = lpm->nodes.data();
+    const LpmNode* n = nodes;
+    const uint8_t* b = ip->ip8;
+
+    if ( ip->is_ip6() )
+        n++;
+
+    while ( true )
+    {
+        unsigned w = *b >> 6;
+        uint64_t bit = 1ull << (*b & 63);
+
+        if ( !(n->child[w] & bit) )
+            return (n->in[w] & bit) != 0;
+
+        n = nodes + n->base + n->rank[w] + __builtin_popcountll(n->child[w] & (bit - 1));
+        ++b;
+    }
+}
+
+#endif
+
@@ -32,6 +32,7 @@
 #include <stdio.h>
 
 #include "util.h"
+#include "sf_iplpm.h"
 #include "sf_vartable.h"
 
 #define LIST_OPEN '['
@@ -57,17 +58,35 @@ void sfvar_free(sfip_var_t* var)
     if (var->value)
         free(var->value);
 
-    if (var->mode == SFIP_LIST)
-    {
-        sfip_node_freelist(var->head);
-        sfip_node_freelist(var->neg_head);
-    }
-    else if (var->mode == SFIP_TABLE)
+    sfip_node_freelist(var->head);
+    sfip_node_freelist(var->neg_head);
+
+    if (var->mode == SFIP_TABLE)
+        sfip_lpm_free(var->lpm);
+
+    free(var);
+}
+
+/* Reverts to list mode before the lists are changed */
+static inline void _sfvar_uncompile(sfip_var_t* var)
+{
+    if (var->mode == SFIP_TABLE)
     {
-        // XXX
+        sfip_lpm_free(var->lpm);
+        var->lpm = NULL;
+        var->mode = SFIP_LIST;
     }
+}
 
-    free(var);
+void sfvar_compile(sfip_var_t* var)
+{
+    if (!var)
+        return;
+
+    _sfvar_uncompile(var);
+
+    var->lpm = sfip_lpm_new(var->head, var->neg_head);
+    var->mode = SFIP_TABLE;
 }
 
 sfip_node_t* sfipnode_alloc(const char* str, SFIP_RET* status)
@@ -190,6 +209,8 @@ SFIP_RET sfvar_add(sfip_var_t* dst, sfip_var_t* src)
     if (!dst || !src)
         return SFIP_ARG_ERR;
 
+    _sfvar_uncompile(dst);
+
     oldhead = dst->head;
     oldneg = dst->neg_head;
 
@@ -201,6 +222,8 @@ SFIP_RET sfvar_add(sfip_var_t* dst, sfip_var_t* src)
     dst->head = copiedvar->head;
     dst->neg_head = copiedvar->neg_head;
 
+    /* Only the lists are kept so drop the reference to the shared table */
+    _sfvar_uncompile(copiedvar);
     free(copiedvar);
 
     if (dst->head)
@@ -239,9 +262,9 @@ SFIP_RET sfvar_add_node(sfip_var_t* var, sfip_node_t* node, int negated)
     if (!var || !node)
         return SFIP_ARG_ERR;
 
-    /* XXX */
-    /* As of this writing, 11/20/06, nodes are always added to
-     * the list, regardless of the mode (list or table). */
+    /* Nodes are always added to the list; the table is rebuilt from
+     * the lists by sfvar_compile(). */
+    _sfvar_uncompile(var);
 
     if (negated)
         head = &var->neg_head;
@@ -289,9 +312,6 @@ SFIP_RET sfvar_add_node(sfip_var_t* var, sfip_node_t* node, int negated)
     p->next = node;
 
     return SFIP_SUCCESS;
-
-    /* XXX Insert new node into routing table */
-//    sfrt_add(node->ip,
 }
 
 static SFIP_RET sfvar_list_compare(sfip_node_t* list1, sfip_node_t* list2)
@@ -421,6 +441,8 @@ static void _negate_lists(sfip_var_t* var)
     sfip_node_t* node;
     sfip_node_t* temp;
 
+    _sfvar_uncompile(var);
+
     for (node = var->head; node; node=node->next)
         _negate_node(node);
 
@@ -774,6 +796,7 @@ sfip_var_t* sfvar_alloc(vartable_t* table, const char* variable, SFIP_RET* statu
         return NULL;
     }
 
+    sfvar_compile(ret);
     return ret;
 }
 
@@ -827,6 +850,10 @@ sfip_var_t* sfvar_deep_copy(const sfip_var_t* var)
     ret->head = _sfvar_deep_copy_list(var->head);
     ret->neg_head = _sfvar_deep_copy_list(var->neg_head);
 
+    /* The lists are the same so the table can be shared */
+    if (var->mode == SFIP_TABLE)
+        ret->lpm = sfip_lpm_ref(var->lpm);
+
     return ret;
 }
 
@@ -975,14 +1002,9 @@ int sfvar_ip_in(sfip_var_t* var, const sfip_t* ip)
     if (!var || !ip)
         return 0;
 
-#if 0
     if (var->mode == SFIP_TABLE)
-    {
-        // XXX
-    }
-    else
-    {
-#endif
+        return sfip_lpm_lookup(var->lpm, ip);
+
     /* Since this is a performance-critical function it uses different
      * codepaths for IPv6 and IPv4 traffic, rather than the dual-stack
      * functions. */
@@ -995,10 +1017,6 @@ int sfvar_ip_in(sfip_var_t* var, const sfip_t* ip)
     {
         return _sfvar_ip_in6(var, ip);
     }
-#if 0
-}
-
-#endif
 }
 
 void sfip_set_print(const char* prefix, sfip_node_t* p)
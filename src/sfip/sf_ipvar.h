@@ -36,6 +36,8 @@
 #include <stdio.h>
 #include "sfip/sf_ip.h"
 
+struct sfip_lpm_t;
+
 /* Selects which mode a given variable is using to
  * store and lookup IP addresses */
 typedef enum _modes
@@ -70,8 +72,8 @@ struct sfip_var_t
     sfip_node_t* neg_head;
 
     /* The mode above will select whether to use the sfip_node_t linked list
-     * or the IP routing table */
-//    sfrt rt;
+     * or the compiled lookup table.  The lists are kept either way. */
+    sfip_lpm_t* lpm;
 
     /* Linked list of IP variables for the variable table */
     sfip_var_t* next;
@@ -125,6 +127,11 @@ SFIP_RET sfvar_compare(const sfip_var_t* one, const sfip_var_t* two);
 /* Deep copy. Returns identical, new, linked list of sfipnodes. */
 sfip_var_t* sfvar_deep_copy(const sfip_var_t* src);
 
+/* Builds the lookup table for 'var' from its lists.  This is done when a
+   variable is allocated or added to; any other change reverts it to list
+   mode until it is compiled again. */
+void sfvar_compile(sfip_var_t* var);
+
 /* Free an allocated variable */
 void sfvar_free(sfip_var_t* var);
 
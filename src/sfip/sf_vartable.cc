@@ -307,8 +307,11 @@ SFIP_RET sfvt_add_to_var(vartable_t* table, sfip_var_t* dst, const char* src)
     if (!table || !dst || !src)
         return SFIP_ARG_ERR;
 
-    if ((ret = sfvar_parse_iplist(table, dst, src, 0)) == SFIP_SUCCESS)
-        return sfvar_validate(dst);
+    if ((ret = sfvar_parse_iplist(table, dst, src, 0)) != SFIP_SUCCESS)
+        return ret;
+
+    if ((ret = sfvar_validate(dst)) == SFIP_SUCCESS)
+        sfvar_compile(dst);
 
     return ret;
 }
@@ -27,8 +27,11 @@
 #include "stream_module.h"
 #include "main/snort_debug.h"
 #include "managers/inspector_manager.h"
+#include "flow/flow_cache.h"
 #include "flow/flow_control.h"
 #include "stream/stream_api.h"
+#include "time/housekeeping.h"
+#include "time/packet_time.h"
 #include "time/profiler.h"
 #include "stream/tcp/tcp_session.h"
 
@@ -58,6 +61,8 @@ struct BaseStats
 
     PegCount file_flows;
     PegCount file_prunes;
+
+    PegCount prune_latency[PRUNE_LAT_BUCKETS];
 };
 
 static BaseStats g_stats;
@@ -77,6 +82,11 @@ const PegInfo base_pegs[] =
     { "user prunes", "user sessions pruned" },
     { "file flows", "total file sessions" },
     { "file prunes", "file sessions pruned" },
+    { "prune 0-1us", "prune operations taking under 1 usec" },
+    { "prune 1-10us", "prune operations taking 1 to 10 usecs" },
+    { "prune 10-100us", "prune operations taking 10 to 100 usecs" },
+    { "prune 100us-1ms", "prune operations taking 100 usecs to 1 msec" },
+    { "prune 1ms+", "prune operations taking over 1 msec" },
     { nullptr, nullptr }
 };
 
@@ -103,6 +113,9 @@ void base_sum()
     t_stats.file_flows = flow_con->get_flows(PktType::FILE);
     t_stats.file_prunes = flow_con->get_prunes(PktType::FILE);
 
+    for ( unsigned i = 0; i < PRUNE_LAT_BUCKETS; ++i )
+        t_stats.prune_latency[i] = flow_con->get_prune_latency(i);
+
     sum_stats((PegCount*)&g_stats, (PegCount*)&t_stats,
         array_size(base_pegs)-1);
 }
@@ -320,6 +333,23 @@ static void base_dtor(Inspector* p)
     delete p;
 }
 
+static void base_housekeeping(bool idle)
+{
+    if ( !flow_con )
+        return;
+
+    if ( idle )
+        flow_con->timeout_flows(16384, time(NULL));
+    else
+        flow_con->timeout_flows(256, packet_time());
+}
+
+static void base_init()
+{
+    // retire idle flows at least once a second under load
+    housekeeping_register("flow timeouts", base_housekeeping, 4096, 1000);
+}
+
 void base_tterm()
 {
     delete flow_con;
@@ -344,7 +374,7 @@ static const InspectApi base_api =
     (unsigned)PktType::ANY_SSN,
     nullptr, // buffers
     nullptr, // service
-    nullptr, // init
+    base_init,
     nullptr, // term
     nullptr, // tinit
     base_tterm,
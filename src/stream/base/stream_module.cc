@@ -42,6 +42,9 @@ static const Parameter name[] = \
  \
     { "idle_timeout", Parameter::PT_INT, "1:", idle, \
       "maximum inactive time before retiring session tracker" }, \
+ \
+    { "flow_table", Parameter::PT_ENUM, "chained | open", "chained", \
+      "hash table used to store flows" }, \
  \
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr } \
 }
@@ -121,6 +124,9 @@ bool StreamModule::set(const char* fqn, Value& v, SnortConfig*)
     else if ( v.is("idle_timeout") )
         fc->nominal_timeout = v.get_long();
 
+    else if ( v.is("flow_table") )
+        fc->table_type = (FlowTableType)v.get_long();
+
     else
         return false;
 
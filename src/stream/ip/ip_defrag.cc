@@ -149,6 +149,7 @@ struct Fragment
 
     int ord;
     char last;
+    uint8_t slot;        /* arena size class, fixed for the life of the slot */
 };
 
 /* statistics tracking struct */
@@ -167,6 +168,10 @@ struct IpStats
     PegCount trackers_released;
     PegCount nodes_created;
     PegCount nodes_released;
+    PegCount slots_reused;
+    PegCount slots_allocated;
+    PegCount slots_trimmed;
+    PegCount arena_exhausted;
 };
 
 const PegInfo ip_pegs[] =
@@ -184,6 +189,10 @@ const PegInfo ip_pegs[] =
     { "trackers freed", "datagram trackers released" },
     { "nodes inserted", "fragments added to tracker" },
     { "nodes deleted", "fragments deleted from tracker" },
+    { "slots reused", "fragment slots taken from the arena cache" },
+    { "slots allocated", "fragment slots allocated from the heap" },
+    { "slots trimmed", "cached fragment slots freed to make room for other sizes" },
+    { "arena exhausted", "fragments dropped for lack of a slot" },
     { nullptr, nullptr }
 };
 
@@ -229,6 +238,172 @@ static inline void add_node(FragTracker*, Fragment*, Fragment*);
 static void delete_frag(Fragment*);
 static void delete_node(FragTracker*, Fragment*);
 
+/*  F R A G M E N T   A R E N A  ************************************/
+
+// each fragment lives in a single slot holding the Fragment followed by
+// its data.  slots come in a few payload sizes and released slots are
+// cached per size for reuse so that steady state traffic doesn't touch
+// the heap.  all slots, in use or cached, count against the memcap.  when
+// a size runs dry at the cap a cached larger slot is borrowed or cached
+// slots of other sizes are freed to make room; failing that the oldest
+// flows are pruned and if that doesn't turn up a slot the fragment is
+// dropped.
+
+static const unsigned frag_slot_size[] = { 128, 512, 1536, 4096, 9216, 65536 };
+
+#define FRAG_SLOT_SIZES (sizeof(frag_slot_size) / sizeof(frag_slot_size[0]))
+
+struct FragArena
+{
+    Fragment* free[FRAG_SLOT_SIZES];  // linked through next
+    unsigned long held;               // bytes in slots, in use or cached
+    bool open;                        // cache released slots
+};
+
+static THREAD_LOCAL FragArena frag_arena;
+
+static inline unsigned slot_bytes(unsigned c)
+{
+    return sizeof(Fragment) + frag_slot_size[c];
+}
+
+static inline unsigned slot_class(uint16_t len)
+{
+    unsigned c = 0;
+
+    while ( frag_slot_size[c] < len )
+        ++c;
+
+    return c;
+}
+
+static inline bool slot_fits(unsigned c)
+{
+    return frag_arena.held + slot_bytes(c) <= FRAG_MEMCAP;
+}
+
+static Fragment* slot_pop(unsigned c)
+{
+    Fragment* f = frag_arena.free[c];
+
+    if ( f )
+    {
+        frag_arena.free[c] = f->next;
+        ip_stats.slots_reused++;
+    }
+    return f;
+}
+
+static Fragment* slot_new(unsigned c)
+{
+    Fragment* f = (Fragment*)SnortAlloc(slot_bytes(c));
+    f->slot = c;
+
+    frag_arena.held += slot_bytes(c);
+    ip_stats.slots_allocated++;
+    return f;
+}
+
+// free cached slots, largest first, until one of size c fits
+static bool slot_trim(unsigned c)
+{
+    for ( unsigned i = FRAG_SLOT_SIZES; i-- > 0 && !slot_fits(c); )
+    {
+        while ( frag_arena.free[i] && !slot_fits(c) )
+        {
+            Fragment* f = frag_arena.free[i];
+            frag_arena.free[i] = f->next;
+            frag_arena.held -= slot_bytes(i);
+            free(f);
+            ip_stats.slots_trimmed++;
+        }
+    }
+    return slot_fits(c);
+}
+
+static Fragment* slot_get(unsigned c)
+{
+    if ( Fragment* f = slot_pop(c) )
+        return f;
+
+    if ( slot_fits(c) )
+        return slot_new(c);
+
+    for ( unsigned i = c + 1; i < FRAG_SLOT_SIZES; ++i )
+    {
+        if ( Fragment* f = slot_pop(i) )
+            return f;
+    }
+
+    if ( slot_trim(c) )
+        return slot_new(c);
+
+    return nullptr;
+}
+
+/**
+ * Get a Fragment with room for len bytes of data
+ *
+ * @param p Current packet, its flow is spared if we have to prune
+ * @param len Length of the fragment data
+ *
+ * @return cleared Fragment with fptr and flen set or NULL if the
+ *         arena is exhausted
+ */
+static Fragment* new_frag(Packet* p, uint16_t len)
+{
+    unsigned c = slot_class(len);
+    Fragment* f = slot_get(c);
+
+    if ( !f )
+    {
+        flow_con->prune_flows(PktType::IP, p);
+        ip_stats.prunes++;
+        f = slot_get(c);
+    }
+
+    if ( !f )
+    {
+        ip_stats.arena_exhausted++;
+        return nullptr;
+    }
+
+    uint8_t slot = f->slot;
+    memset(f, 0, sizeof(*f));
+    f->slot = slot;
+
+    f->fptr = (uint8_t*)(f + 1);
+    f->flen = len;
+
+    mem_in_use += slot_bytes(slot);
+    sfBase.frag_mem_in_use = mem_in_use;
+
+    ip_stats.nodes_created++;
+    return f;
+}
+
+static void open_arena()
+{
+    frag_arena.open = true;
+}
+
+// flows may still be holding fragments; those go straight back to the
+// heap when released
+static void close_arena()
+{
+    frag_arena.open = false;
+
+    for ( unsigned c = 0; c < FRAG_SLOT_SIZES; ++c )
+    {
+        while ( Fragment* f = frag_arena.free[c] )
+        {
+            frag_arena.free[c] = f->next;
+            frag_arena.held -= slot_bytes(c);
+            free(f);
+        }
+    }
+}
+
 /**
  * Print out a defrag engine
  *
@@ -1009,17 +1184,20 @@ static inline void add_node(FragTracker* ft, Fragment* prev,
  */
 static void delete_frag(Fragment* frag)
 {
-    /*
-     * delete the fragment either in prealloc or dynamic mode
-     */
-    {
-        free(frag->fptr);
-        mem_in_use -= frag->flen;
+    unsigned c = frag->slot;
 
-        free(frag);
-        mem_in_use -= sizeof(Fragment);
+    mem_in_use -= slot_bytes(c);
+    sfBase.frag_mem_in_use = mem_in_use;
 
-        sfBase.frag_mem_in_use = mem_in_use;
+    if ( frag_arena.open )
+    {
+        frag->next = frag_arena.free[c];
+        frag_arena.free[c] = frag;
+    }
+    else
+    {
+        frag_arena.held -= slot_bytes(c);
+        free(frag);
     }
 
     ip_stats.nodes_released++;
@@ -1127,6 +1305,8 @@ void Defrag::tinit()
 
     defrag_pkts[0] = PacketManager::encode_new();
     pkt_snaplen = DAQ_GetSnapLen();
+
+    open_arena();
 }
 
 void Defrag::tterm()
@@ -1142,6 +1322,8 @@ void Defrag::tterm()
 
     delete[] defrag_pkts;
     defrag_pkts = nullptr;
+
+    close_arena();
 }
 
 void Defrag::show(SnortConfig*)
@@ -2140,6 +2322,14 @@ int Defrag::new_tracker(Packet* p, FragTracker* ft)
         return 0;
     }
 
+    /*
+     * get our first fragment storage struct
+     */
+    f = new_frag(p, fragLength);
+
+    if ( !f )
+        return 0;
+
     memset(ft, 0, sizeof(*ft));
 
     if ( p->is_ip4() )
@@ -2174,25 +2364,6 @@ int Defrag::new_tracker(Packet* p, FragTracker* ft)
     ft->frag_policy = p->flow->ssn_policy ? p->flow->ssn_policy : engine.frag_policy;
     ft->engine = &engine;
 
-    /*
-     * get our first fragment storage struct
-     */
-    {
-        if (mem_in_use > FRAG_MEMCAP)
-        {
-            flow_con->prune_flows(PktType::IP, p);
-        }
-
-        f = (Fragment*)SnortAlloc(sizeof(Fragment));
-        mem_in_use += sizeof(Fragment);
-
-        f->fptr = (uint8_t*)SnortAlloc(fragLength);
-        mem_in_use += fragLength;
-
-        sfBase.frag_mem_in_use = mem_in_use;
-    }
-
-    ip_stats.nodes_created++;
     sfBase.iFragCreates++;
     sfBase.iCurrentFrags++;
     if (sfBase.iCurrentFrags > sfBase.iMaxFrags)
@@ -2206,7 +2377,7 @@ int Defrag::new_tracker(Packet* p, FragTracker* ft)
      */
     memcpy(f->fptr, fragStart, fragLength);
 
-    f->size = f->flen = fragLength;
+    f->size = fragLength;
     f->offset = frag_off;
     frag_end = f->offset + fragLength;
     f->ord = ft->ordinal++;
@@ -2325,32 +2496,13 @@ int Defrag::add_frag_node(FragTracker* ft,
     }
 
     /*
-     * grab/generate a new frag node
+     * grab a new frag node with space to hold the actual data
      */
-    {
-        if (mem_in_use > FRAG_MEMCAP)
-        {
-            flow_con->prune_flows(PktType::IP, p);
-        }
-
-        /*
-         * build a frag struct to track this particular fragment
-         */
-        newfrag = (Fragment*)SnortAlloc(sizeof(Fragment));
-        mem_in_use += sizeof(Fragment);
-
-        /*
-         * allocate some space to hold the actual data
-         */
-        newfrag->fptr = (uint8_t*)SnortAlloc(fragLength);
-        mem_in_use += fragLength;
-
-        sfBase.frag_mem_in_use = mem_in_use;
-    }
+    newfrag = new_frag(p, fragLength);
 
-    ip_stats.nodes_created++;
+    if ( !newfrag )
+        return FRAG_INSERT_FAILED;
 
-    newfrag->flen = fragLength;
     memcpy(newfrag->fptr, fragStart, fragLength);
     newfrag->ord = ft->ordinal++;
 
@@ -2412,36 +2564,17 @@ int Defrag::dup_frag_node(
     Fragment* newfrag = NULL;  /* new frag container */
 
     /*
-     * grab/generate a new frag node
+     * grab a new frag node with space to hold a copy of left
      */
-    {
-        if (mem_in_use > FRAG_MEMCAP)
-        {
-            flow_con->prune_flows(PktType::IP, p);
-        }
-
-        /*
-         * build a frag struct to track this particular fragment
-         */
-        newfrag = (Fragment*)SnortAlloc(sizeof(Fragment));
-        mem_in_use += sizeof(Fragment);
-
-        /*
-         * allocate some space to hold the actual data
-         */
-        newfrag->fptr = (uint8_t*)SnortAlloc(left->flen);
-        mem_in_use += left->flen;
+    newfrag = new_frag(p, left->flen);
 
-        sfBase.frag_mem_in_use = mem_in_use;
-    }
-
-    ip_stats.nodes_created++;
+    if ( !newfrag )
+        return FRAG_INSERT_FAILED;
 
     newfrag->ord = ft->ordinal++;
     /*
      * twiddle the frag values for overlaps
      */
-    newfrag->flen = left->flen;
     memcpy(newfrag->fptr, left->fptr, newfrag->flen);
     newfrag->data = newfrag->fptr + (left->data - left->fptr);
     newfrag->size = left->size;
@@ -48,6 +48,7 @@
 #define STREAM_CONFIG_STATIC_FLUSHPOINTS       0x00000200
 #define STREAM_CONFIG_IPS                      0x00000400
 #define STREAM_CONFIG_NO_ASYNC_REASSEMBLY      0x00000800
+#define STREAM_CONFIG_ZERO_COPY                0x00001000
 
 /* traffic direction identification */
 #define FROM_SERVER     0
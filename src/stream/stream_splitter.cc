@@ -29,17 +29,29 @@ static THREAD_LOCAL uint8_t pdu_buf[65536];
 static THREAD_LOCAL StreamBuffer str_buf;
 
 unsigned StreamSplitter::max_pdu = 16384;
+bool StreamSplitter::zero_copy = false;
 
 void StreamSplitter::set_max(unsigned m)
 { max_pdu = m; }
 
+void StreamSplitter::set_zero_copy(bool b)
+{ zero_copy = b; }
+
 unsigned StreamSplitter::max(Flow*)
 { return max_pdu; }
 
 const StreamBuffer* StreamSplitter::reassemble(
-    Flow*, unsigned, unsigned offset, const uint8_t* p,
+    Flow*, unsigned total, unsigned offset, const uint8_t* p,
     unsigned n, uint32_t flags, unsigned& copied)
 {
+    if ( zero_copy and !offset and n == total and (flags & PKT_PDU_TAIL) )
+    {
+        // the caller's data outlives the returned buffer so just use it
+        str_buf.data = p;
+        str_buf.length = n;
+        copied = n;
+        return &str_buf;
+    }
     assert(offset + n < sizeof(pdu_buf));
     memcpy(pdu_buf+offset, p, n);
     copied = n;
@@ -84,6 +84,10 @@ public:
     // different paf_max; the HI splitter should pull from there
     static void set_max(unsigned);
 
+    // when set, the default reassemble() returns the given data as is
+    // instead of copying it if the entire pdu is passed in one call
+    static void set_zero_copy(bool);
+
     virtual void reset() { }
     virtual void update() { }
 
@@ -95,6 +99,7 @@ protected:
 
 private:
     static unsigned max_pdu;
+    static bool zero_copy;
     bool c2s;
 };
 
@@ -69,6 +69,7 @@ void StreamTcp::show(SnortConfig*)
 bool StreamTcp::configure(SnortConfig*)
 {
     StreamSplitter::set_max(config->paf_max);
+    StreamSplitter::set_zero_copy((config->flags & STREAM_CONFIG_ZERO_COPY) != 0);
     return true;
 }
 
@@ -37,6 +37,7 @@ struct StreamTcpConfig
 
     uint32_t max_queued_bytes;
     uint32_t max_queued_segs;
+    uint32_t seglist_index;
 
     uint32_t max_consec_small_segs;
     uint32_t max_consec_small_seg_size;
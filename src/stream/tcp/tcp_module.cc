@@ -90,6 +90,9 @@ static const Parameter stream_queue_limit_params[] =
     { "max_segments", Parameter::PT_INT, "0:", "2621",
       "don't queue more than given segments per session and direction" },
 
+    { "index_segments", Parameter::PT_INT, "0:", "64",
+      "index queued segments by sequence number when at least this many are queued; 0 disables" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -134,6 +137,9 @@ static const Parameter s_params[] =
     { "footprint", Parameter::PT_INT, "0:", "0",
       "use zero for production, non-zero for testing at given size" },
 
+    { "zero_copy_flush", Parameter::PT_BOOL, nullptr, "false",
+      "flush PDUs contained in a single segment without copying" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -259,6 +265,9 @@ bool StreamTcpModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("max_segments") )
         config->max_queued_segs = v.get_long();
 
+    else if ( v.is("index_segments") )
+        config->seglist_index = v.get_long();
+
     else if ( v.is("max_window") )
         config->max_window = v.get_long();
 
@@ -292,6 +301,13 @@ bool StreamTcpModule::set(const char*, Value& v, SnortConfig*)
         else
             config->flags &= ~STREAM_CONFIG_SHOW_PACKETS;
     }
+    else if ( v.is("zero_copy_flush") )
+    {
+        if ( v.get_bool() )
+            config->flags |= STREAM_CONFIG_ZERO_COPY;
+        else
+            config->flags &= ~STREAM_CONFIG_ZERO_COPY;
+    }
     else
         return false;
 
@@ -324,3 +340,6 @@ const PegInfo* StreamTcpModule::get_pegs() const
 PegCount* StreamTcpModule::get_counts() const
 { return (PegCount*)&tcpStats; }
 
+bool StreamTcpModule::is_max_peg(unsigned idx) const
+{ return tcp_is_max_peg(idx); }
+
@@ -54,6 +54,8 @@
 
 extern const PegInfo tcp_pegs[];
 extern THREAD_LOCAL struct TcpStats tcpStats;
+
+bool tcp_is_max_peg(unsigned);
 extern THREAD_LOCAL ProfileStats s5TcpPerfStats;
 extern THREAD_LOCAL ProfileStats s5TcpNewSessPerfStats;
 extern THREAD_LOCAL ProfileStats s5TcpStatePerfStats;
@@ -95,6 +97,7 @@ public:
     ProfileStats* get_profile(unsigned, const char*&, const char*&) const override;
     const PegInfo* get_pegs() const override;
     PegCount* get_counts() const override;
+    bool is_max_peg(unsigned) const override;
 
 private:
     StreamTcpConfig* config;
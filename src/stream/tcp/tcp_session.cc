@@ -50,6 +50,7 @@
 
 #include <errno.h>
 #include <assert.h>
+#include <set>
 
 #include "stream_tcp.h"
 #include "tcp_module.h"
@@ -116,10 +117,18 @@ struct TcpStats
     PegCount segs_released;
     PegCount segs_split;
     PegCount segs_used;
+    PegCount seg_pool_hits;
+    PegCount seg_pool_misses;
+    PegCount seg_pool_peak;
     PegCount rebuilt_packets;
     PegCount rebuilt_buffers;
+    PegCount copies_avoided;
     PegCount overlaps;
     PegCount gaps;
+    PegCount seglist_peak;
+    PegCount seglist_steps;
+    PegCount seglist_lookups;
+    PegCount seglist_indexes;
     PegCount max_segs;
     PegCount max_bytes;
     PegCount internalEvents;
@@ -146,10 +155,18 @@ const PegInfo tcp_pegs[] =
     { "segs released", "total segments released" },
     { "segs split", "tcp segments split when reassembling PDUs" },
     { "segs used", "queued tcp segments applied to reassembled PDUs" },
+    { "seg pool hits", "segments allocated from the segment pool" },
+    { "seg pool misses", "segments allocated from the heap" },
+    { "seg pool peak", "maximum bytes held by the segment pool of one thread" },
     { "rebuilt packets", "total reassembled PDUs" },
     { "rebuilt buffers", "rebuilt PDU sections" },
+    { "copies avoided", "PDUs flushed directly from a queued segment" },
     { "overlaps", "overlapping segments queued" },
     { "gaps", "missing data between PDUs" },
+    { "seglist peak", "maximum segments queued on one tracker" },
+    { "seglist steps", "queued segments walked to place out of order segments" },
+    { "seglist lookups", "out of order segments placed with the seglist index" },
+    { "seglist indexes", "seglist indexes built" },
     { "max segs", "number of times the maximum queued segment limit was reached" },
     { "max bytes", "number of times the maximum queued byte limit was reached" },
     { "internal events", "135:X events generated" },
@@ -159,6 +176,14 @@ const PegInfo tcp_pegs[] =
 };
 
 THREAD_LOCAL TcpStats tcpStats;
+
+// the peaks are combined across threads with max
+bool tcp_is_max_peg(unsigned idx)
+{
+    return idx == offsetof(TcpStats, seg_pool_peak) / sizeof(PegCount) ||
+        idx == offsetof(TcpStats, seglist_peak) / sizeof(PegCount);
+}
+
 THREAD_LOCAL Memcap* tcp_memcap = nullptr;
 
 /*  M A C R O S  **************************************************/
@@ -276,6 +301,7 @@ THREAD_LOCAL Memcap* tcp_memcap = nullptr;
 #define STREAM_DEFAULT_MAX_QUEUED_BYTES 1048576 /* 1 MB */
 #define AVG_PKT_SIZE            400
 #define STREAM_DEFAULT_MAX_QUEUED_SEGS (STREAM_DEFAULT_MAX_QUEUED_BYTES/AVG_PKT_SIZE)
+#define STREAM_DEFAULT_SEGLIST_INDEX 64
 
 #define STREAM_DEFAULT_MAX_SMALL_SEG_SIZE 0    /* disabled */
 #define STREAM_DEFAULT_CONSEC_SMALL_SEGS 0     /* disabled */
@@ -424,33 +450,144 @@ static const char* const flush_policy_names[] =
 static THREAD_LOCAL Packet* s5_pkt = nullptr;
 
 //-------------------------------------------------------------------------
-// TcpSegment stuff
+// segment pool
+// -- segments are carved from per thread free lists of power of 2 size
+//    classes so that queueing doesn't touch the heap in steady state
+// -- blocks in use are charged to the tcp memcap at their class size
+// -- idle blocks are only retained while in use + idle stays under the
+//    memcap; they are returned to the heap when the memcap is reached
+// -- segments too large for the biggest class come from the heap
+// -- the pool is closed when the thread terminates; segments released by
+//    flows purged after that go straight back to the heap
 //-------------------------------------------------------------------------
 
-TcpSegment* TcpSegment::init(
-    Packet* p, const struct timeval& tv, const uint8_t* data, unsigned dsize)
+#define SEG_POOL_MIN_SHIFT 7    // 128 byte blocks
+#define SEG_POOL_CLASSES   8    // ... thru 16K byte blocks
+#define SEG_POOL_HEAP      SEG_POOL_CLASSES
+
+struct SegmentPool
+{
+    TcpSegment* free_list[SEG_POOL_CLASSES];
+    uint64_t idle;  // bytes held on free lists
+    uint64_t held;  // bytes held in use + idle
+    bool closed;
+};
+
+static THREAD_LOCAL SegmentPool seg_pool;
+
+static inline unsigned seg_pool_block(unsigned c)
+{
+    return 1 << (SEG_POOL_MIN_SHIFT + c);
+}
+
+static inline unsigned seg_pool_class(unsigned size)
+{
+    unsigned c = 0;
+
+    while ( c < SEG_POOL_CLASSES and seg_pool_block(c) < size )
+        ++c;
+
+    return c;
+}
+
+static void seg_pool_purge()
+{
+    for ( unsigned c = 0; c < SEG_POOL_CLASSES; ++c )
+    {
+        while ( TcpSegment* ss = seg_pool.free_list[c] )
+        {
+            seg_pool.free_list[c] = ss->next;
+            free(ss);
+        }
+    }
+    seg_pool.held -= seg_pool.idle;
+    seg_pool.idle = 0;
+}
+
+static inline TcpSegment* seg_pool_get(unsigned c, unsigned size)
 {
     TcpSegment* ss;
-    unsigned size = sizeof(*ss);
+
+    if ( c < SEG_POOL_CLASSES and (ss = seg_pool.free_list[c]) )
+    {
+        seg_pool.free_list[c] = ss->next;
+        seg_pool.idle -= size;
+        tcpStats.seg_pool_hits++;
+        return ss;
+    }
+    ss = (TcpSegment*)malloc(size);
+
+    if ( !ss )
+        return nullptr;
+
+    seg_pool.held += size;
+
+    if ( seg_pool.held > tcpStats.seg_pool_peak )
+        tcpStats.seg_pool_peak = seg_pool.held;
+
+    tcpStats.seg_pool_misses++;
+    return ss;
+}
+
+static inline void seg_pool_put(TcpSegment* ss, unsigned c, unsigned size)
+{
+    uint64_t cap = tcp_memcap->get_cap();
+
+    if ( c < SEG_POOL_CLASSES and !seg_pool.closed and
+        (!cap or tcp_memcap->used() + seg_pool.idle + size <= cap) )
+    {
+        ss->next = seg_pool.free_list[c];
+        seg_pool.free_list[c] = ss;
+        seg_pool.idle += size;
+        return;
+    }
+    seg_pool.held -= size;
+    free(ss);
+}
+
+//-------------------------------------------------------------------------
+// TcpSegment stuff
+//-------------------------------------------------------------------------
+
+static inline unsigned seg_size(unsigned c, unsigned dsize)
+{
+    if ( c < SEG_POOL_CLASSES )
+        return seg_pool_block(c);
+
+    unsigned size = sizeof(TcpSegment);
 
     if ( dsize > 0 )
         size += dsize - 1;  // ss contains 1st byte
 
+    return size;
+}
+
+TcpSegment* TcpSegment::init(
+    Packet* p, const struct timeval& tv, const uint8_t* data, unsigned dsize)
+{
+    TcpSegment* ss;
+    unsigned c = seg_pool_class(seg_size(SEG_POOL_HEAP, dsize));
+    unsigned size = seg_size(c, dsize);
+
     tcp_memcap->alloc(size);
 
     if ( tcp_memcap->at_max() )
     {
         sfBase.iStreamFaults++;
+        seg_pool_purge();
 
         // FIXIT eliminate the packet dependency?
         if ( p )
             flow_con->prune_flows(PktType::TCP, p);
     }
 
-    ss = (TcpSegment*)malloc(size);
+    ss = seg_pool_get(c, size);
 
     if ( !ss )
+    {
+        tcp_memcap->dealloc(size);
         return nullptr;
+    }
 
     ss->tv = tv;
     memcpy(ss->data, data, dsize);
@@ -462,19 +599,19 @@ TcpSegment* TcpSegment::init(
     ss->size = ss->orig_dsize;
     ss->urg_offset = 0;
     ss->buffered = 0;
+    ss->pool_class = c;
 
     return ss;
 }
 
 void TcpSegment::term(TcpSegment* seg)
 {
-    unsigned dropped = sizeof(TcpSegment);
-
-    if ( seg->size > 0 )
-        dropped += seg->size - 1;  // seg contains 1st byte
+    // charge back what init() charged; size may have been trimmed since
+    unsigned c = seg->pool_class;
+    unsigned size = seg_size(c, seg->orig_dsize);
 
-    tcp_memcap->dealloc(dropped);
-    free(seg);
+    tcp_memcap->dealloc(size);
+    seg_pool_put(seg, c, size);
     tcpStats.segs_released++;
 }
 
@@ -491,6 +628,94 @@ bool TcpSegment::is_retransmit(const uint8_t* rdata, uint16_t rsize, uint32_t rs
     return false;
 }
 
+//-------------------------------------------------------------------------
+// seglist index
+// -- once a seglist reaches config->seglist_index segments, the segments
+//    are also kept in a tree ordered by seq so that out of order segments
+//    find their place in log time instead of walking the list
+// -- the tree compares the current seq of each segment; trimming changes
+//    seq but never the order of segments so the tree stays valid
+// -- segments are added to the tree at their list position so ties (as
+//    from DupStreamNode) keep the list order
+// -- the index is dropped when the seglist falls below half the threshold
+//-------------------------------------------------------------------------
+
+struct SegLess
+{
+    bool operator()(const TcpSegment* a, const TcpSegment* b) const
+    { return SEQ_LT(a->seq, b->seq); }
+};
+
+typedef std::multiset<TcpSegment*, SegLess> SegSet;
+
+struct SegIndex
+{
+    SegSet segs;
+};
+
+static SegSet::iterator seg_index_find(SegSet& segs, TcpSegment* ss)
+{
+    SegSet::iterator it = segs.lower_bound(ss);
+
+    while ( *it != ss )
+        ++it;
+
+    return it;
+}
+
+static void seg_index_build(TcpTracker* st)
+{
+    SegIndex* si = new SegIndex;
+
+    for ( TcpSegment* ss = st->seglist; ss; ss = ss->next )
+        si->segs.insert(si->segs.end(), ss);
+
+    st->seg_index = si;
+    tcpStats.seglist_indexes++;
+}
+
+static void seg_index_drop(TcpTracker* st)
+{
+    delete st->seg_index;
+    st->seg_index = nullptr;
+}
+
+// call after ss is linked into the seglist
+static inline void seg_index_add(TcpTracker* st, TcpSegment* ss)
+{
+    if ( !st->seg_index )
+    {
+        if ( st->config and st->config->seglist_index and
+            st->seg_count >= st->config->seglist_index )
+            seg_index_build(st);
+        return;
+    }
+    SegSet& segs = st->seg_index->segs;
+    segs.insert(ss->next ? seg_index_find(segs, ss->next) : segs.end(), ss);
+}
+
+// call before ss is unlinked from the seglist
+static inline void seg_index_remove(TcpTracker* st, TcpSegment* ss)
+{
+    if ( !st->seg_index )
+        return;
+
+    if ( 2 * (st->seg_count - 1) < st->config->seglist_index )
+        seg_index_drop(st);
+    else
+        st->seg_index->segs.erase(seg_index_find(st->seg_index->segs, ss));
+}
+
+// returns the first segment at or after seq
+static inline TcpSegment* seg_index_right(TcpTracker* st, uint32_t seq)
+{
+    TcpSegment key;
+    key.seq = seq;
+
+    SegSet::iterator it = st->seg_index->segs.lower_bound(&key);
+    return (it == st->seg_index->segs.end()) ? nullptr : *it;
+}
+
 //-------------------------------------------------------------------------
 // flush policy stuff
 //-------------------------------------------------------------------------
@@ -649,6 +874,7 @@ StreamTcpConfig::StreamTcpConfig()
 
     max_queued_bytes = STREAM_DEFAULT_MAX_QUEUED_BYTES;
     max_queued_segs = STREAM_DEFAULT_MAX_QUEUED_SEGS;
+    seglist_index = STREAM_DEFAULT_SEGLIST_INDEX;
 
     max_consec_small_segs = STREAM_DEFAULT_CONSEC_SMALL_SEGS;
     max_consec_small_seg_size = STREAM_DEFAULT_MAX_SMALL_SEG_SIZE;
@@ -704,6 +930,11 @@ static void StreamPrintTcpConfig(StreamTcpConfig* config)
         LogMessage("    Maximum number of segs to queue per session: %d\n",
             config->max_queued_segs);
     }
+    if (config->seglist_index != 0)
+    {
+        LogMessage("    Index seglists from: %u segments\n",
+            config->seglist_index);
+    }
     if (config->flags)
     {
         LogMessage("    Options:\n");
@@ -715,6 +946,10 @@ static void StreamPrintTcpConfig(StreamTcpConfig* config)
         {
             LogMessage("        Don't queue packets on one-sided sessions: YES\n");
         }
+        if (config->flags & STREAM_CONFIG_ZERO_COPY)
+        {
+            LogMessage("        Zero copy flush: YES\n");
+        }
     }
     if (config->hs_timeout < 0)
         LogMessage("    Require 3-Way Handshake: NO\n");
@@ -1829,6 +2064,7 @@ static inline int purge_to_seq(TcpSession *tcpssn, TcpTracker *st, uint32_t flus
 
 static inline void purge_all (TcpTracker *st)
 {
+    seg_index_drop(st);
     DeleteSeglist(st->seglist);
     st->seglist = st->seglist_tail = st->seglist_next = NULL;
     st->seg_count = st->flush_count = 0;
@@ -1906,7 +2142,7 @@ static inline unsigned int getSegmentFlushSize(
  * flush the client seglist up to the most recently acked segment
  */
 static int FlushStream(
-    Packet* p, TcpTracker *st, uint32_t toSeq, uint8_t *flushbuf,
+    Packet* p, TcpTracker *st, uint32_t toSeq, Packet* pdu, uint8_t *flushbuf,
     const uint8_t *flushbuf_end)
 {
     uint16_t bytes_flushed = 0;
@@ -1944,13 +2180,12 @@ static int FlushStream(
 
         if ( sb )
         {
-            s5_pkt->data = sb->data;
-            s5_pkt->dsize = sb->length;
-            assert(sb->length <= s5_pkt->max_dsize);
+            if ( sb->data == ss->payload )
+                tcpStats.copies_avoided++;
 
-            // FIXIT-M flushbuf should be eliminated from this function
-            // since we are actually using the stream splitter buffer
-            flushbuf = (uint8_t*)s5_pkt->data;
+            pdu->data = sb->data;
+            pdu->dsize = sb->length;
+            assert(sb->length <= pdu->max_dsize);
 
             // ensure we stop here
             bytes_to_copy = bytes_copied;
@@ -1972,7 +2207,11 @@ static int FlushStream(
         st->flush_count++;
         segs++;
 
-        if ( flushbuf >= flushbuf_end )
+        // FIXIT-M flushbuf should be eliminated from this function
+        // since we are actually using the stream splitter buffer.
+        // sb->data may be a segment (zero copy) so it can't be
+        // compared with flushbuf_end.
+        if ( !sb && flushbuf >= flushbuf_end )
             break;
 
         if ( SEQ_EQ(ss->seq + bytes_to_copy,  toSeq) )
@@ -2008,6 +2247,15 @@ static int FlushStream(
     return bytes_flushed;
 }
 
+// pdu->data is reset to the flush buffer for each pdu because a zero
+// copy flush leaves it pointing into a queued segment
+int tcp_flush_pdu(Packet* p, TcpTracker* st, uint32_t toSeq, Packet* pdu, uint8_t* buf)
+{
+    pdu->data = buf;
+    pdu->dsize = 0;
+    return FlushStream(p, st, toSeq, pdu, buf, buf + pdu->max_dsize);
+}
+
 // FIXIT-L consolidate encode format, update, and this into new function?
 static void prep_s5_pkt(Flow* flow, Packet* p, uint32_t pkt_flags)
 {
@@ -2077,6 +2325,7 @@ static inline int _flush_to_seq(
 #endif
 
     prep_s5_pkt(tcpssn->flow, p, pkt_flags);
+    uint8_t* flush_buf = (uint8_t*)s5_pkt->data;
 
     // if not specified, set bytes to flush to what was acked
     if ( !bytes && SEQ_GT(st->r_win_base, st->seglist_base_seq) )
@@ -2124,9 +2373,7 @@ static inline int _flush_to_seq(
         ((DAQ_PktHdr_t*)s5_pkt->pkth)->ts.tv_usec = st->seglist_next->tv.tv_usec;
 
         /* setup the pseudopacket payload */
-        s5_pkt->dsize = 0;
-        const uint8_t* s5_pkt_end = s5_pkt->data + s5_pkt->max_dsize;
-        flushed_bytes = FlushStream(p, st, stop_seq, (uint8_t*)s5_pkt->data, s5_pkt_end);
+        flushed_bytes = tcp_flush_pdu(p, st, stop_seq, s5_pkt, flush_buf);
 
         if ( !flushed_bytes )
             break; /* No more data... bail */
@@ -2159,6 +2406,9 @@ static inline int _flush_to_seq(
 
                 Snort::detect_rebuilt_packet(s5_pkt);
 
+                // the segment a zero copy pdu points into may be purged
+                s5_pkt->data = flush_buf;
+
                 MODULE_PROFILE_END(s5TcpProcessRebuiltPerfStats);
             }
             MODULE_PROFILE_TMPSTART(s5TcpFlushPerfStats);
@@ -3135,13 +3385,21 @@ static int StreamQueue(TcpTracker *st, Packet *p, TcpDataBlock *tdb,
         dist_head = dist_tail = 0;
     }
 
-    if (SEQ_LEQ(dist_head, dist_tail))
+    if ( st->seg_index )
+    {
+        right = seg_index_right(st, seq);
+        left = right ? right->prev : st->seglist_tail;
+        tcpStats.seglist_lookups++;
+    }
+    else if (SEQ_LEQ(dist_head, dist_tail))
     {
         TcpSegment* ss;
 
         /* Start iterating at the head (left) */
         for (ss = st->seglist; ss; ss = ss->next)
         {
+            tcpStats.seglist_steps++;
+
             STREAM_DEBUG_WRAP(
                 DebugMessage(DEBUG_STREAM_STATE,
                 "ss: %p  seq: 0x%X  size: %lu delta: %d\n",
@@ -3172,6 +3430,8 @@ static int StreamQueue(TcpTracker *st, Packet *p, TcpDataBlock *tdb,
         /* Start iterating at the tail (right) */
         for (ss = st->seglist_tail; ss; ss = ss->prev)
         {
+            tcpStats.seglist_steps++;
+
             STREAM_DEBUG_WRAP(
                 DebugMessage(DEBUG_STREAM_STATE,
                 "ss: %p  seq: 0x%X  size: %lu delta: %d\n",
@@ -5866,6 +6126,11 @@ static void StreamSeglistAddNode(
     st->seg_bytes_total += ss->orig_dsize;
     st->total_segs_queued++;
     tcpStats.segs_queued++;
+
+    if ( st->seg_count > tcpStats.seglist_peak )
+        tcpStats.seglist_peak = st->seg_count;
+
+    seg_index_add(st, ss);
 }
 
 static int StreamSeglistDeleteNode (TcpTracker* st, TcpSegment* seg)
@@ -5877,6 +6142,8 @@ static int StreamSeglistDeleteNode (TcpTracker* st, TcpSegment* seg)
         "Dropping segment at seq %X, len %d\n",
         seg->seq, seg->size); );
 
+    seg_index_remove(st, seg);
+
     if (seg->prev)
         seg->prev->next = seg->next;
     else
@@ -6572,11 +6839,15 @@ void TcpSession::set_memcap(Memcap& mc)
 void TcpSession::sinit()
 {
     s5_pkt = PacketManager::encode_new();
+    seg_pool.closed = false;
     //AtomSplitter::init();  // FIXIT-L PAF implement
 }
 
 void TcpSession::sterm()
 {
+    seg_pool_purge();
+    seg_pool.closed = true;
+
     if (s5_pkt)
     {
         PacketManager::encode_delete(s5_pkt);
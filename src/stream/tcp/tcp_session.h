@@ -103,6 +103,7 @@ struct TcpSegment
 
     uint16_t urg_offset;
     uint8_t buffered;
+    uint8_t pool_class;  // segment pool size class or heap
 
     uint8_t data[1];     // variable length
 };
@@ -134,6 +135,7 @@ struct TcpTracker
     // the segment to flush from and is set per packet.  should keep
     // up to date.
     TcpSegment* seglist_next;
+    struct SegIndex* seg_index;  // seglist by seq when long; see tcp_session.cc
 
     /* Local for these variables means the local part of the connection.  For
      * example, if this particular TcpTracker was tracking the client side
@@ -175,6 +177,10 @@ struct TcpTracker
     StreamAlertInfo alerts[MAX_SESSION_ALERTS]; /* history of alerts */
 };
 
+// reassemble the next pdu from st up to toSeq into pdu, using buf as the
+// flush buffer; returns the number of bytes flushed
+int tcp_flush_pdu(struct Packet* p, TcpTracker*, uint32_t toSeq, struct Packet* pdu, uint8_t* buf);
+
 // FIXIT-L session tracking must be split from reassembly
 // into a separate module a la ip_session.cc and ip_defrag.cc
 // (of course defrag should also be cleaned up)
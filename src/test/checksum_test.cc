@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+// Copyright (C) 2009-2013 Sourcefire, Inc.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// checksum_test.cc
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
+#endif
+
+#include <check.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#endif
+
+#include "codecs/ip/checksum.h"
+
+using namespace checksum::detail;
+
+// compare the vector kernels to the scalar code on random buffers of
+// random length and alignment including the all zero and all ones cases
+// that sit on either side of the one's complement wrap
+
+#define NUM_FUZZ 20000
+#define MAX_LEN 70000
+
+static uint8_t s_buf[MAX_LEN + 32];
+static uint32_t s_seed = 1;
+
+static uint32_t next_rand()
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return s_seed >> 8;
+}
+
+static void fill(size_t len, int mode)
+{
+    for ( size_t i = 0; i < len; ++i )
+        s_buf[i] = (mode == 0) ? (uint8_t)next_rand() : (mode == 1) ? 0xFF : 0;
+}
+
+#ifdef CKSUM_X86
+static int FuzzCheck(int i)
+{
+    size_t len = (i % 16) ? next_rand() % 2048 : next_rand() % MAX_LEN;
+    unsigned off = next_rand() % 32;
+    uint32_t init = (i & 1) ? next_rand() & 0x3FFFF : 0;
+
+    fill(len + off, next_rand() % 3);
+
+    const uint16_t* p = (const uint16_t*)(s_buf + off);
+    uint16_t c = cksum_add_c(p, len, init);
+
+    if ( __builtin_cpu_supports("sse2") && cksum_add_sse2(p, len, init) != c )
+        return 0;
+
+    if ( __builtin_cpu_supports("avx2") && cksum_add_avx2(p, len, init) != c )
+        return 0;
+
+    return cksum_add(p, len, init) == c;
+}
+#endif
+
+// the checksum of data including its own checksum is zero
+static int VerifyCheck(int i)
+{
+    size_t len = 20 + 2 * (next_rand() % 1000);
+    fill(len, i % 3);
+
+    s_buf[10] = s_buf[11] = 0;
+    uint16_t c = cksum_add((const uint16_t*)s_buf, len, 0);
+    memcpy(s_buf + 10, &c, sizeof(c));
+
+    return cksum_add((const uint16_t*)s_buf, len, 0) == 0;
+}
+
+//---------------------------------------------------------------
+
+#ifdef CKSUM_X86
+START_TEST (test_fuzz)
+{
+    fail_unless(FuzzCheck(_i) == 1, "FuzzCheck()");
+}
+
+END_TEST
+#endif
+
+START_TEST (test_verify)
+{
+    fail_unless(VerifyCheck(_i) == 1, "VerifyCheck()");
+}
+
+END_TEST
+
+Suite* TEST_SUITE_checksum(void)
+{
+    Suite* ps = suite_create("checksum");
+
+    TCase* tc = tcase_create("kernels");
+#ifdef CKSUM_X86
+    tcase_add_loop_test(tc, test_fuzz, 0, NUM_FUZZ);
+#endif
+    tcase_add_loop_test(tc, test_verify, 0, 100);
+    suite_add_tcase(ps, tc);
+
+    return ps;
+}
+
@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// fast_decode_test.cc
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
+#endif
+
+#include <check.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#endif
+
+extern "C" {
+#include <daq.h>
+}
+
+#include "protocols/packet.h"
+#include "protocols/packet_manager.h"
+#include "codecs/ip/checksum.h"
+
+// decode an eth/ipv4/tcp packet, which takes the fast path, and make sure
+// the accumulated stats count it once for each of the codecs
+
+#define ETH_LEN 14
+#define IP4_LEN 20
+#define TCP_LEN 20
+#define DATA_LEN 8
+#define PKT_LEN (ETH_LEN + IP4_LEN + TCP_LEN + DATA_LEN)
+
+static uint8_t s_pkt[PKT_LEN];
+
+static void build_packet()
+{
+    uint8_t* eth = s_pkt;
+    uint8_t* ip = eth + ETH_LEN;
+    uint8_t* tcp = ip + IP4_LEN;
+
+    memset(s_pkt, 0, sizeof(s_pkt));
+
+    // macs, ethertype ipv4
+    memcpy(eth, "\x00\x01\x02\x03\x04\x05\x00\x06\x07\x08\x09\x0a", 12);
+    eth[12] = 0x08;
+    eth[13] = 0x00;
+
+    // ipv4 10.1.1.1 -> 10.1.1.2, df, ttl 64, tcp
+    ip[0] = 0x45;
+    ip[2] = (IP4_LEN + TCP_LEN + DATA_LEN) >> 8;
+    ip[3] = (IP4_LEN + TCP_LEN + DATA_LEN) & 0xFF;
+    ip[4] = 0x12;
+    ip[6] = 0x40;
+    ip[8] = 64;
+    ip[9] = 6;
+    memcpy(ip + 12, "\x0a\x01\x01\x01\x0a\x01\x01\x02", 8);
+
+    uint16_t sum = checksum::ip_cksum((uint16_t*)ip, IP4_LEN);
+    memcpy(ip + 10, &sum, sizeof(sum));
+
+    // tcp 1234 -> 80, ack with a little data
+    tcp[0] = 1234 >> 8;
+    tcp[1] = 1234 & 0xFF;
+    tcp[3] = 80;
+    tcp[7] = 1;
+    tcp[11] = 1;
+    tcp[12] = (TCP_LEN / 4) << 4;
+    tcp[13] = 0x10;
+    tcp[14] = 0x20;
+    memset(tcp + TCP_LEN, 'x', DATA_LEN);
+
+    checksum::Pseudoheader ph;
+    memcpy(&ph.sip, ip + 12, sizeof(ph.sip));
+    memcpy(&ph.dip, ip + 16, sizeof(ph.dip));
+    ph.zero = 0;
+    ph.protocol = 6;
+    ph.len = htons(TCP_LEN + DATA_LEN);
+
+    sum = checksum::tcp_cksum((uint16_t*)tcp, TCP_LEN + DATA_LEN, &ph);
+    memcpy(tcp + 16, &sum, sizeof(sum));
+}
+
+START_TEST (test_eth_ip4_tcp)
+{
+    static const char* codecs[] = { "eth", "ipv4", "tcp" };
+    const unsigned num_codecs = sizeof(codecs) / sizeof(codecs[0]);
+    PegCount before[num_codecs];
+
+    build_packet();
+
+    DAQ_PktHdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.caplen = hdr.pktlen = PKT_LEN;
+
+    for ( unsigned i = 0; i < num_codecs; ++i )
+        before[i] = PacketManager::test_count(codecs[i]);
+
+    Packet* p = PacketManager::encode_new(false);
+    PacketManager::test_decode(p, &hdr, s_pkt, "eth");
+
+    fail_unless(p->num_layers == num_codecs, "layers");
+    fail_unless(p->dsize == DATA_LEN, "payload");
+
+    for ( unsigned i = 0; i < num_codecs; ++i )
+        fail_unless(PacketManager::test_count(codecs[i]) == before[i] + 1,
+            "codec %s counted %u times", codecs[i],
+            (unsigned)(PacketManager::test_count(codecs[i]) - before[i]));
+
+    PacketManager::encode_delete(p);
+}
+
+END_TEST
+
+Suite* TEST_SUITE_fast_decode(void)
+{
+    Suite* ps = suite_create("fast_decode");
+
+    TCase* tc = tcase_create("stats");
+    tcase_add_test(tc, test_eth_ip4_tcp);
+    suite_add_tcase(ps, tc);
+
+    return ps;
+}
+
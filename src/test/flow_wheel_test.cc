@@ -0,0 +1,244 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flow_wheel_test.cc
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
+#endif
+
+#include <check.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#endif
+
+#include "flow/flow.h"
+#include "flow/flow_wheel.h"
+
+#define BASE_TIME 1000
+#define MAX_WORK 100000
+
+static unsigned num_expired(FlowWheel& fw)
+{
+    unsigned n = 0;
+
+    for ( Flow* f = fw.get_expired(); f; f = f->wheel_next )
+        ++n;
+
+    return n;
+}
+
+START_TEST (test_add_advance)
+{
+    FlowWheel fw;
+    Flow f;
+
+    fw.add(&f, BASE_TIME + 10);
+    fail_unless(fw.get_count() == 1, "count after add");
+
+    // the first add starts the wheel
+    fail_unless(fw.behind(BASE_TIME + 10), "wheel not started");
+    fail_unless(!fw.behind(BASE_TIME + 9), "wheel started early");
+
+    fw.advance(BASE_TIME + 9, MAX_WORK);
+    fail_unless(!fw.get_expired(), "expired early");
+
+    fw.advance(BASE_TIME + 10, MAX_WORK);
+    fail_unless(fw.get_expired() == &f, "not expired");
+    fail_unless(fw.get_count() == 1, "count after expire");
+
+    fw.remove(&f);
+    fail_unless(!fw.get_expired(), "expired list not empty");
+    fail_unless(fw.get_count() == 0, "count after remove");
+}
+
+END_TEST
+
+START_TEST (test_remove)
+{
+    FlowWheel fw;
+    Flow f[3];
+
+    for ( unsigned i = 0; i < 3; ++i )
+        fw.add(f + i, BASE_TIME + 5);
+
+    // from the middle of a slot
+    fw.remove(f + 1);
+    fail_unless(fw.get_count() == 2, "count after remove");
+
+    fw.advance(BASE_TIME + 5, MAX_WORK);
+    fail_unless(num_expired(fw) == 2, "expired after remove");
+
+    for ( Flow* p = fw.get_expired(); p; p = p->wheel_next )
+        fail_unless(p != f + 1, "removed flow expired");
+
+    // removing twice is harmless
+    fw.remove(f + 1);
+    fw.remove(f + 2);
+    fw.remove(f);
+    fail_unless(fw.get_count() == 0, "count after removing all");
+    fail_unless(!fw.get_expired(), "expired list not empty");
+}
+
+END_TEST
+
+START_TEST (test_order)
+{
+    FlowWheel fw;
+    Flow start, f[4];
+
+    // the first add starts the wheel at that time
+    fw.add(&start, BASE_TIME);
+
+    // scheduled out of order within level 0
+    fw.add(f + 0, BASE_TIME + 3);
+    fw.add(f + 1, BASE_TIME + 1);
+    fw.add(f + 2, BASE_TIME + 2);
+    fw.add(f + 3, BASE_TIME + 200);
+    fw.remove(&start);
+
+    fw.advance(BASE_TIME + 2, MAX_WORK);
+    fail_unless(num_expired(fw) == 2, "expired by time 2");
+
+    fw.advance(BASE_TIME + 199, MAX_WORK);
+    fail_unless(num_expired(fw) == 3, "expired by time 199");
+
+    fw.advance(BASE_TIME + 200, MAX_WORK);
+    fail_unless(num_expired(fw) == 4, "expired by time 200");
+
+    // the expired list is in scheduled order
+    Flow* p = fw.get_expired();
+    fail_unless(p == f + 1, "first expired");
+    p = p->wheel_next;
+    fail_unless(p == f + 2, "second expired");
+    p = p->wheel_next;
+    fail_unless(p == f + 0, "third expired");
+    p = p->wheel_next;
+    fail_unless(p == f + 3, "fourth expired");
+}
+
+END_TEST
+
+START_TEST (test_reschedule)
+{
+    FlowWheel fw;
+    Flow f;
+
+    fw.add(&f, BASE_TIME + 10);
+
+    // moving it later on the wheel
+    fw.add(&f, BASE_TIME + 20);
+    fail_unless(fw.get_count() == 1, "count after move");
+
+    fw.advance(BASE_TIME + 19, MAX_WORK);
+    fail_unless(!fw.get_expired(), "expired at old time");
+
+    fw.advance(BASE_TIME + 20, MAX_WORK);
+    fail_unless(fw.get_expired() == &f, "not expired at new time");
+
+    // and back onto the wheel from the expired list
+    fw.add(&f, BASE_TIME + 30);
+    fail_unless(!fw.get_expired(), "still expired after reschedule");
+    fail_unless(fw.get_count() == 1, "count after reschedule");
+
+    fw.advance(BASE_TIME + 30, MAX_WORK);
+    fail_unless(fw.get_expired() == &f, "not expired after reschedule");
+
+    // a time that has passed is checked on the next advance
+    fw.add(&f, BASE_TIME + 5);
+    fw.advance(BASE_TIME + 31, MAX_WORK);
+    fail_unless(fw.get_expired() == &f, "late add not expired");
+}
+
+END_TEST
+
+START_TEST (test_level1)
+{
+    FlowWheel fw;
+    Flow f[3];
+
+    fw.add(f + 0, BASE_TIME);
+
+    // level 1 and beyond the last level 1 slot
+    fw.add(f + 1, BASE_TIME + 1000);
+    fw.add(f + 2, BASE_TIME + 20000);
+
+    fw.advance(BASE_TIME + 999, MAX_WORK);
+    fail_unless(num_expired(fw) == 1, "level 1 expired early");
+
+    fw.advance(BASE_TIME + 1000, MAX_WORK);
+    fail_unless(num_expired(fw) == 2, "level 1 not expired");
+
+    fw.advance(BASE_TIME + 19999, MAX_WORK);
+    fail_unless(num_expired(fw) == 2, "parked flow expired early");
+
+    fw.advance(BASE_TIME + 20000, MAX_WORK);
+    fail_unless(num_expired(fw) == 3, "parked flow not expired");
+}
+
+END_TEST
+
+START_TEST (test_bounded)
+{
+    FlowWheel fw;
+    Flow f[10];
+
+    for ( unsigned i = 0; i < 10; ++i )
+        fw.add(f + i, BASE_TIME + i);
+
+    // each call does a little and picks up where the last one stopped
+    unsigned calls = 0;
+
+    while ( fw.behind(BASE_TIME + 9) and calls < 100 )
+    {
+        fw.advance(BASE_TIME + 9, 2);
+        ++calls;
+    }
+
+    fail_unless(calls > 1, "advance not bounded");
+    fail_unless(num_expired(fw) == 10, "not all expired");
+
+    Flow* p = fw.get_expired();
+
+    for ( unsigned i = 0; i < 10; ++i, p = p->wheel_next )
+        fail_unless(p == f + i, "bounded expire out of order");
+}
+
+END_TEST
+
+Suite* TEST_SUITE_flow_wheel(void)
+{
+    Suite* ps = suite_create("flow_wheel");
+
+    TCase* tc = tcase_create("wheel");
+    tcase_add_test(tc, test_add_advance);
+    tcase_add_test(tc, test_remove);
+    tcase_add_test(tc, test_order);
+    tcase_add_test(tc, test_reschedule);
+    tcase_add_test(tc, test_level1);
+    tcase_add_test(tc, test_bounded);
+    suite_add_tcase(ps, tc);
+
+    return ps;
+}
+
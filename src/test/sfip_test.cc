@@ -21,6 +21,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <string>
+
 #if defined(__clang__)
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
@@ -34,6 +36,8 @@
 
 #include "snort_types.h"
 #include "sfip/sf_ip.h"
+#include "sfip/sf_ipvar.h"
+#include "sfip/sf_vartable.h"
 
 //---------------------------------------------------------------
 
@@ -235,6 +239,50 @@ static FuncTest ftests[] =
 
 //---------------------------------------------------------------
 
+typedef struct
+{
+    const char* var;
+    const char* ip;
+    int expected;
+} VarTest;
+
+static VarTest vtests[] =
+{
+    { "[1.2.3.4]", "1.2.3.4", 1 },
+    { "[1.2.3.4]", "1.2.3.5", 0 },
+    { "[1.2.0.0/16]", "1.2.255.255", 1 },
+    { "[1.2.0.0/16]", "1.3.0.0", 0 },
+    { "[1.2.0.0/15]", "1.3.0.0", 1 },
+    { "[1.2.0.0/16, !1.2.3.0/24]", "1.2.4.1", 1 },
+    { "[1.2.0.0/16, !1.2.3.0/24]", "1.2.3.1", 0 },
+    { "[1.2.0.0/16, !1.2.3.4]", "1.2.3.4", 0 },
+    { "[1.2.0.0/16, !1.2.3.4]", "1.2.3.5", 1 },
+    { "[!1.2.3.0/24]", "1.2.3.1", 0 },
+    { "[!1.2.3.0/24]", "1.2.4.1", 1 },
+    { "[!1.2.3.0/24]", "ffff::1", 1 },
+    { "[1.2.3.0/24]", "ffff::1", 0 },
+    { "[any]", "1.2.3.4", 1 },
+    { "[any]", "ffff::1", 1 },
+    { "[1.2.3.0/24, any, !1.2.3.4]", "1.2.3.4", 0 },
+    { "[1.2.3.0/24, any, !1.2.3.4]", "9.9.9.9", 1 },
+    { "[ffff::/16]", "ffff:1::1", 1 },
+    { "[ffff::/16]", "fffe::1", 0 },
+    { "[ffff::/16]", "255.255.0.1", 0 },
+    { "[ffff::/16, !ffff:1::/32]", "ffff:1::1", 0 },
+    { "[ffff::/16, !ffff:1::/32]", "ffff:2::1", 1 },
+    { "[ffff::1/127]", "ffff::0", 1 },
+    { "[ffff::1/127]", "ffff::2", 0 },
+    { "[10.0.0.0/8, 192.168.0.0/16, !10.1.0.0/16, !10.2.3.4]", "10.3.0.1", 1 },
+    { "[10.0.0.0/8, 192.168.0.0/16, !10.1.0.0/16, !10.2.3.4]", "10.1.0.1", 0 },
+    { "[10.0.0.0/8, 192.168.0.0/16, !10.1.0.0/16, !10.2.3.4]", "10.2.3.4", 0 },
+    { "[10.0.0.0/8, 192.168.0.0/16, !10.1.0.0/16, !10.2.3.4]", "192.168.9.9", 1 },
+    { "[10.0.0.0/8, 192.168.0.0/16, !10.1.0.0/16, !10.2.3.4]", "172.16.0.1", 0 },
+};
+
+#define NUM_VAR_TESTS (sizeof(vtests)/sizeof(vtests[0]))
+
+//---------------------------------------------------------------
+
 static int RunFunc(const char* func, const char* arg1, const char* arg2)
 {
     sfip_t ip1, ip2;
@@ -452,6 +500,34 @@ static int CopyCheck(int i)
     return (status == SFIP_SUCCESS) && !memcmp(&ip1, &ip2, sizeof(ip1));
 }
 
+// the compiled table must agree with the lists
+static int VarCheck(int i)
+{
+    VarTest* t = vtests + i;
+    vartable_t* table = sfvt_alloc_table();
+    sfip_var_t* var = nullptr;
+    sfip_t ip;
+
+    std::string s = "var ";
+    s += t->var;
+
+    if ( sfvt_add_str(table, s.c_str(), &var) != SFIP_SUCCESS or
+        sfip_pton(t->ip, &ip) != SFIP_SUCCESS )
+    {
+        sfvt_free_table(table);
+        return 0;
+    }
+
+    int table_in = sfvar_ip_in(var, &ip);
+    var->mode = SFIP_LIST;
+    int list_in = sfvar_ip_in(var, &ip);
+    var->mode = SFIP_TABLE;
+
+    sfvt_free_table(table);
+
+    return table_in == t->expected and list_in == t->expected;
+}
+
 //---------------------------------------------------------------
 // check specific stuff: http://check.sourceforge.net/
 //
@@ -482,6 +558,11 @@ END_TEST START_TEST(test_copy)
     fail_unless(CopyCheck(_i) == 1, "CopyCheck()");
 }
 
+END_TEST START_TEST(test_var)
+{
+    fail_unless(VarCheck(_i) == 1, "VarCheck()");
+}
+
 END_TEST
 
 Suite* TEST_SUITE_sfip(void)
@@ -499,6 +580,10 @@ Suite* TEST_SUITE_sfip(void)
     tcase_add_loop_test(tc, test_raw, 0, 2);
     suite_add_tcase(ps, tc);
 
+    tc = tcase_create("ipvar");
+    tcase_add_loop_test(tc, test_var, 0, NUM_VAR_TESTS);
+    suite_add_tcase(ps, tc);
+
     return ps;
 }
 
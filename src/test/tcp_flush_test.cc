@@ -0,0 +1,129 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// tcp_flush_test.cc
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
+#endif
+
+#include <check.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#endif
+
+#include "protocols/packet.h"
+#include "protocols/packet_manager.h"
+#include "stream/stream_splitter.h"
+#include "stream/tcp/tcp_session.h"
+
+// flush two single segment pdus back to back with zero copy.  the
+// segments are placed after the flush buffer so that a segment pointer
+// compared with the end of the flush buffer is always past it.
+
+#define SEG_SIZE 100
+#define SEG_SPACE 256  // per segment, multiple of 8
+#define BASE_SEQ 1000
+
+class TestSplitter : public StreamSplitter
+{
+public:
+    TestSplitter() : StreamSplitter(true) { }
+
+    Status scan(Flow*, const uint8_t*, uint32_t, uint32_t, uint32_t*) override
+    { return SEARCH; }
+};
+
+static uint64_t s_arena[(Packet::max_dsize + 2 * SEG_SPACE) / 8 + 1];
+
+static TcpSegment* get_seg(unsigned i)
+{
+    uint8_t* b = (uint8_t*)s_arena + Packet::max_dsize + 1;
+    b += 8 - ((uintptr_t)b & 7);
+    return (TcpSegment*)(b + i * SEG_SPACE);
+}
+
+START_TEST (test_back_to_back)
+{
+    TestSplitter splitter;
+    TcpTracker st;
+    memset(&st, 0, sizeof(st));
+    st.splitter = &splitter;
+
+    TcpSegment* seg[2];
+
+    for ( unsigned i = 0; i < 2; ++i )
+    {
+        seg[i] = get_seg(i);
+        memset(seg[i], 0, sizeof(*seg[i]));
+        memset(seg[i]->data, 'a' + i, SEG_SIZE);
+        seg[i]->payload = seg[i]->data;
+        seg[i]->seq = BASE_SEQ + i * SEG_SIZE;
+        seg[i]->size = seg[i]->orig_dsize = SEG_SIZE;
+    }
+    seg[0]->next = seg[1];
+    seg[1]->prev = seg[0];
+
+    st.seglist = st.seglist_next = seg[0];
+    st.seglist_tail = seg[1];
+
+    Packet* pdu = PacketManager::encode_new(false);
+    uint8_t* buf = (uint8_t*)s_arena;
+
+    StreamSplitter::set_zero_copy(true);
+
+    int n = tcp_flush_pdu(pdu, &st, BASE_SEQ + SEG_SIZE, pdu, buf);
+
+    fail_unless(n == SEG_SIZE, "first flush size");
+    fail_unless(pdu->data == seg[0]->payload, "first flush not zero copy");
+    fail_unless(pdu->dsize == SEG_SIZE, "first pdu size");
+    fail_unless(seg[0]->buffered, "first segment not flushed");
+
+    // the caller restarts from the first unflushed segment
+    st.seglist_next = seg[1];
+
+    n = tcp_flush_pdu(pdu, &st, BASE_SEQ + 2 * SEG_SIZE, pdu, buf);
+
+    fail_unless(n == SEG_SIZE, "second flush size");
+    fail_unless(pdu->data == seg[1]->payload, "second flush not zero copy");
+    fail_unless(pdu->dsize == SEG_SIZE, "second pdu size");
+    fail_unless(pdu->data[0] == 'b', "second pdu data");
+    fail_unless(st.flush_count == 2, "segment flushed more than once");
+
+    StreamSplitter::set_zero_copy(false);
+    PacketManager::encode_delete(pdu);
+}
+
+END_TEST
+
+Suite* TEST_SUITE_tcp_flush(void)
+{
+    Suite* ps = suite_create("tcp_flush");
+
+    TCase* tc = tcase_create("zero_copy");
+    tcase_add_test(tc, test_back_to_back);
+    suite_add_tcase(ps, tc);
+
+    return ps;
+}
+
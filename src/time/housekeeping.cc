@@ -0,0 +1,201 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// housekeeping.cc
+
+#include "housekeeping.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <string>
+
+#include "housekeeping_module.h"
+#include "main/snort_config.h"
+#include "utils/stats.h"
+#include "utils/util.h"
+
+#define MAX_TASKS 16
+
+struct HousekeepingTask
+{
+    const char* name;
+    HousekeepingFunc func;
+    unsigned packets;
+    unsigned msecs;
+};
+
+// per thread
+struct TaskState
+{
+    uint64_t next_packet;
+    uint64_t next_usec;
+    PegCount runs;
+    PegCount usecs;
+    PegCount max_usecs;
+};
+
+static HousekeepingTask tasks[MAX_TASKS];
+static unsigned num_tasks = 0;
+
+static TaskState task_totals[MAX_TASKS];
+
+static THREAD_LOCAL TaskState task_state[MAX_TASKS];
+static THREAD_LOCAL unsigned next_task = 0;
+
+THREAD_LOCAL HousekeepingState hk_state;
+THREAD_LOCAL HousekeepingStats hk_stats;
+
+static inline uint64_t get_usecs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline bool is_due(const TaskState& ts, uint64_t now)
+{
+    return hk_state.packets >= ts.next_packet or now >= ts.next_usec;
+}
+
+static uint64_t run_task(unsigned i, bool idle, uint64_t start)
+{
+    tasks[i].func(idle);
+
+    uint64_t now = get_usecs();
+    uint64_t usecs = now - start;
+    TaskState& ts = task_state[i];
+
+    ts.runs++;
+    ts.usecs += usecs;
+
+    if ( usecs > ts.max_usecs )
+        ts.max_usecs = usecs;
+
+    ts.next_packet = hk_state.packets + tasks[i].packets;
+    ts.next_usec = now + tasks[i].msecs * 1000;
+
+    return now;
+}
+
+//-------------------------------------------------------------------------
+// public methods
+//-------------------------------------------------------------------------
+
+// FIXIT-L tasks can only be registered before packet threads start
+void housekeeping_register(
+    const char* name, HousekeepingFunc func, unsigned packets, unsigned msecs)
+{
+    if ( num_tasks == MAX_TASKS )
+    {
+        ErrorMessage("too many housekeeping tasks; ignoring %s\n", name);
+        return;
+    }
+    HousekeepingTask& t = tasks[num_tasks++];
+
+    t.name = name;
+    t.func = func;
+    t.packets = packets ? packets : 1;
+    t.msecs = msecs;
+}
+
+void housekeeping_tinit()
+{
+    uint64_t now = get_usecs();
+
+    for ( unsigned i = 0; i < num_tasks; ++i )
+    {
+        task_state[i].next_packet = tasks[i].packets;
+        task_state[i].next_usec = now + tasks[i].msecs * 1000;
+    }
+    hk_state.packets = 0;
+    hk_state.next_check = SnortConfig::get_housekeeping_packets();
+}
+
+void housekeeping_run()
+{
+    hk_state.next_check = hk_state.packets + SnortConfig::get_housekeeping_packets();
+    hk_stats.checks++;
+
+    unsigned budget = SnortConfig::get_housekeeping_budget();
+
+    if ( !budget )
+        return;
+
+    uint64_t start = get_usecs();
+    uint64_t now = start;
+
+    // round robin so that tasks deferred by the budget go first next time
+    for ( unsigned n = 0; n < num_tasks; ++n )
+    {
+        unsigned i = (next_task + n) % num_tasks;
+
+        if ( !is_due(task_state[i], now) )
+            continue;
+
+        if ( now - start >= budget )
+        {
+            hk_stats.deferred++;
+            next_task = i;
+            return;
+        }
+        now = run_task(i, false, now);
+    }
+}
+
+void housekeeping_idle()
+{
+    uint64_t now = get_usecs();
+
+    for ( unsigned i = 0; i < num_tasks; ++i )
+        now = run_task(i, true, now);
+}
+
+//-------------------------------------------------------------------------
+// stats
+//-------------------------------------------------------------------------
+
+// called with the stats lock held
+void housekeeping_sum()
+{
+    for ( unsigned i = 0; i < num_tasks; ++i )
+    {
+        task_totals[i].runs += task_state[i].runs;
+        task_totals[i].usecs += task_state[i].usecs;
+
+        if ( task_state[i].max_usecs > task_totals[i].max_usecs )
+            task_totals[i].max_usecs = task_state[i].max_usecs;
+
+        task_state[i].runs = task_state[i].usecs = task_state[i].max_usecs = 0;
+    }
+}
+
+void housekeeping_show()
+{
+    for ( unsigned i = 0; i < num_tasks; ++i )
+    {
+        if ( !task_totals[i].runs )
+            continue;
+
+        std::string s = tasks[i].name;
+        LogCount((s + " runs").c_str(), task_totals[i].runs);
+        LogCount((s + " usecs").c_str(), task_totals[i].usecs);
+        LogCount((s + " max usecs").c_str(), task_totals[i].max_usecs);
+    }
+}
+
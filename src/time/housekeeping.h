@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// housekeeping.h
+
+#ifndef HOUSEKEEPING_H
+#define HOUSEKEEPING_H
+
+// housekeeping runs bounded slices of periodic work on the packet threads
+// so that it isn't starved when the DAQ always has packets.  tasks are
+// registered at startup with a packet period and a wall clock period; a
+// task is due when either has elapsed.
+//
+// housekeeping_check() is called after each packet.  it only looks at the
+// clock every housekeeping.check_packets packets and then runs due tasks
+// until housekeeping.budget usecs are spent; tasks that don't get a turn
+// go first next time.  housekeeping_idle() runs every task when the DAQ
+// has nothing to do.
+
+#include "main/snort_types.h"
+#include "main/thread.h"
+
+// idle is true when called from housekeeping_idle()
+using HousekeepingFunc = void (*)(bool idle);
+
+void housekeeping_register(
+    const char* name, HousekeepingFunc, unsigned packets, unsigned msecs);
+
+void housekeeping_tinit();
+
+void housekeeping_run();
+void housekeeping_idle();
+
+struct HousekeepingState
+{
+    uint64_t packets;
+    uint64_t next_check;
+};
+
+extern THREAD_LOCAL HousekeepingState hk_state;
+
+inline void housekeeping_check()
+{
+    if ( ++hk_state.packets >= hk_state.next_check )
+        housekeeping_run();
+}
+
+// stats support
+void housekeeping_sum();
+void housekeeping_show();
+
+#endif
+
@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// housekeeping_module.cc
+
+#include "housekeeping_module.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "housekeeping.h"
+#include "main/snort_config.h"
+
+#define s_name "housekeeping"
+#define s_help \
+    "periodic work done by packet threads under load"
+
+static const Parameter s_params[] =
+{
+    { "budget", Parameter::PT_INT, "0:1000000", "50",
+      "maximum usecs of housekeeping per check, 0 = only when idle" },
+
+    { "check_packets", Parameter::PT_INT, "1:65535", "64",
+      "check for due tasks after this many packets" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+static const PegInfo hk_pegs[] =
+{
+    { "checks", "checks for due housekeeping tasks" },
+    { "deferred", "due tasks put off because the budget was spent" },
+    { nullptr, nullptr }
+};
+
+//-------------------------------------------------------------------------
+// housekeeping module
+//-------------------------------------------------------------------------
+
+HousekeepingModule::HousekeepingModule() : Module(s_name, s_help, s_params) { }
+
+const PegInfo* HousekeepingModule::get_pegs() const
+{ return hk_pegs; }
+
+PegCount* HousekeepingModule::get_counts() const
+{ return (PegCount*)&hk_stats; }
+
+bool HousekeepingModule::set(const char*, Value& v, SnortConfig* sc)
+{
+    if ( v.is("budget") )
+        sc->housekeeping_budget = v.get_long();
+
+    else if ( v.is("check_packets") )
+        sc->housekeeping_packets = v.get_long();
+
+    else
+        return false;
+
+    return true;
+}
+
+void HousekeepingModule::sum_stats()
+{
+    housekeeping_sum();
+    Module::sum_stats();
+}
+
+void HousekeepingModule::show_stats()
+{
+    Module::show_stats();
+    housekeeping_show();
+}
+
@@ -0,0 +1,51 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2014-2015 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// housekeeping_module.h
+
+#ifndef HOUSEKEEPING_MODULE_H
+#define HOUSEKEEPING_MODULE_H
+
+// Configuration module for packet thread housekeeping
+
+#include "framework/module.h"
+#include "main/thread.h"
+
+struct HousekeepingStats
+{
+    PegCount checks;
+    PegCount deferred;
+};
+
+extern THREAD_LOCAL HousekeepingStats hk_stats;
+
+class HousekeepingModule : public Module
+{
+public:
+    HousekeepingModule();
+
+    bool set(const char*, Value&, SnortConfig*) override;
+
+    const PegInfo* get_pegs() const override;
+    PegCount* get_counts() const override;
+
+    void sum_stats() override;
+    void show_stats() override;
+};
+
+#endif
+
@@ -183,6 +183,9 @@ struct DAQStats
     PegCount skipped;
     PegCount fail_open;
     PegCount idle;
+    PegCount batches;
+    PegCount batch_usecs;
+    PegCount batch_time[4];
 };
 
 //-------------------------------------------------------------------------
@@ -210,6 +213,12 @@ const PegInfo daq_names[] =
     { "skipped", "packets skipped at startup" },
     { "fail open", "packets passed during initialization" },
     { "idle", "attempts to acquire from DAQ without available packets" },
+    { "batches", "acquires from DAQ that returned packets" },
+    { "batch usecs", "total time spent in acquires that returned packets" },
+    { "batch 0-100us", "batches processed in under 100 usecs" },
+    { "batch 100us-1ms", "batches processed in 100 usecs to 1 msec" },
+    { "batch 1-10ms", "batches processed in 1 to 10 msecs" },
+    { "batch 10ms+", "batches processed in over 10 msecs" },
     { nullptr, nullptr }
 };
 
@@ -225,6 +234,8 @@ const PegInfo pc_names[] =
     { "header searches", "fast pattern searches in header buffer" },
     { "body searches", "fast pattern searches in body buffer" },
     { "file searches", "fast pattern searches in file buffer" },
+    { "rtn checks", "rule header evaluations" },
+    { "rtn cache hits", "rule header evaluations answered by an earlier result for the packet" },
     { "alerts", "alerts not including IP reputation" },
     { "total alerts", "alerts including IP reputation" },
     { "logged", "logged packets" },
@@ -300,6 +311,11 @@ static void get_daq_stats(DAQStats& daq_stats)
     daq_stats.skipped = snort_conf->pkt_skip;
     daq_stats.fail_open = gaux.total_fail_open;
     daq_stats.idle = gaux.idle;
+    daq_stats.batches = gaux.batches;
+    daq_stats.batch_usecs = gaux.batch_usecs;
+
+    for ( unsigned i = 0; i < array_size(gaux.batch_time); i++ )
+        daq_stats.batch_time[i] = gaux.batch_time[i];
 }
 
 void DropStats()
@@ -47,6 +47,8 @@ struct PacketCount
     PegCount header_searches;
     PegCount body_searches;
     PegCount file_searches;
+    PegCount rtn_checks;
+    PegCount rtn_cache_hits;
     PegCount alert_pkts;
     PegCount total_alert_pkts;
     PegCount log_pkts;
@@ -74,6 +76,9 @@ struct AuxCount
     PegCount internal_whitelist;
     PegCount total_fail_open;
     PegCount idle;
+    PegCount batches;
+    PegCount batch_usecs;
+    PegCount batch_time[4];
 };
 
 extern ProcessCount proc_stats;